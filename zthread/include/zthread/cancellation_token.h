@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTCANCELLATIONTOKEN_H__
+#define __ZTCANCELLATIONTOKEN_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/task.h"
+
+namespace zthread {
+
+class CancellationState;
+
+/**
+ * @class CancellationToken
+ *
+ * Cancels a group of tasks, such as the work done for one request, without
+ * disturbing the other tasks an executor runs. Copies of a token refer to
+ * the same state.
+ *
+ * Tasks are bound to a token when they are submitted, with
+ * PoolExecutor::Execute(const Task&, CancellationToken, Priority),
+ * ThreadedExecutor::Execute(const Task&, CancellationToken), or
+ * bind() for any other Executor. Once the token is canceled,
+ *
+ * - tasks bound to it that have not started are skipped when their turn
+ *   comes, without being run;
+ * - the threads running tasks bound to it are interrupted, so a task
+ *   blocked in a wait, a sleep or a queue throws an Interrupted_Exception;
+ * - a task can also poll isCanceled(), which costs a single atomic load.
+ *
+ * Tokens form a tree: canceling a token cancels the tokens created from it
+ * by child(), and theirs, so canceling a subtree costs time in proportion
+ * to the tokens and running tasks in that subtree, not to the size of the
+ * executor.
+ *
+ * @code
+ *
+ * CancellationToken request;
+ *
+ * pool.Execute(new Parse(input), request);
+ * pool.Execute(new Fetch(url), request.child());
+ *
+ * // Later, when the client goes away
+ * request.cancel();
+ *
+ * @endcode
+ */
+class ZTHREAD_API CancellationToken {
+  CountedPtr<CancellationState> _state;
+
+  //! Flag of the state, so polling it is a single load
+  volatile bool* _canceled;
+
+  CancellationToken(CancellationState* state);
+
+ public:
+  //! Create a token that is not part of any tree
+  CancellationToken();
+
+  CancellationToken(const CancellationToken& token);
+
+  ~CancellationToken();
+
+  CancellationToken& operator=(const CancellationToken& token);
+
+  /**
+   * Create a token that is canceled along with this one. The child is
+   * canceled from the start if this token already is.
+   */
+  CancellationToken child();
+
+  /**
+   * Cancel this token and its descendants, interrupting the threads running
+   * tasks bound to any of them. Canceling a token more than once has no
+   * effect.
+   */
+  void cancel();
+
+  //! Test whether this token, or one of its ancestors, has been canceled
+  bool isCanceled() const;
+
+  /**
+   * Wrap a task so it is skipped if this token is canceled before it
+   * starts, and its thread is interrupted if the token is canceled while
+   * it runs. The returned Task can be submitted to any Executor.
+   */
+  Task bind(const Task& task);
+};
+
+}  // namespace zthread
+
+#endif  // __ZTCANCELLATIONTOKEN_H__
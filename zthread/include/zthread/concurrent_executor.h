@@ -100,6 +100,13 @@ class ConcurrentExecutor : public Executor {
    */
   virtual void Execute(const Task&);
 
+  /**
+   * Submit a batch of Tasks to this Executor, to be run in order.
+   *
+   * @see Executor::ExecuteAll(const Task*, const Task*)
+   */
+  virtual void ExecuteAll(const Task* begin, const Task* end);
+
   /**
    * @see Cancelable::Cancel()
    */
@@ -110,6 +117,16 @@ class ConcurrentExecutor : public Executor {
    */
   virtual bool IsCanceled();
 
+  /**
+   * @see PoolExecutor::getCpuTime()
+   */
+  unsigned long long getCpuTime();
+
+  /**
+   * @see PoolExecutor::getMetrics()
+   */
+  ExecutorMetrics getMetrics();
+
   /**
    * @see PoolExecutor::wait()
    */
@@ -0,0 +1,726 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTCOROUTINE_H__
+#define __ZTCOROUTINE_H__
+
+#if !defined(__cpp_impl_coroutine)
+#error "zthread/coroutine.h requires a compiler with C++20 coroutines"
+#endif
+
+#include "zthread/exceptions.h"
+#include "zthread/executor.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/future.h"
+#include "zthread/guard.h"
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace zthread {
+
+/**
+ * The coroutine layer. It is built when the library is configured with
+ * ZTHREAD_COROUTINES, and lets a small pool of threads serve any number of
+ * coroutines: a coroutine waiting for a lock or a queue is suspended,
+ * rather than holding on to the thread that runs it, and is resumed by
+ * submitting it to an Executor once it can proceed.
+ *
+ * Its names mirror those of the thread based classes they stand in for, so
+ * they are kept in a namespace of their own.
+ *
+ * @code
+ *
+ * coro::Task<void> handle(PoolExecutor& pool, coro::BlockingQueue<Request>&
+ *                         requests) {
+ *   for (;;) {
+ *     Request r = co_await requests.Next();  // no thread is held here
+ *     co_await process(r);
+ *   }
+ * }
+ *
+ * coro::spawn(pool, handle(pool, requests));
+ *
+ * @endcode
+ */
+namespace coro {
+
+/**
+ * Resume a coroutine on a thread of an Executor.
+ *
+ * @exception Cancellation_Exception thrown if the Executor does not accept
+ *            it, in which case the coroutine is not resumed.
+ */
+ZTHREAD_API void post(Executor& executor, std::coroutine_handle<> handle);
+
+/**
+ * Resume a coroutine on a thread of an Executor, or on the calling thread
+ * if the Executor does not accept it.
+ */
+ZTHREAD_API void resume(Executor& executor,
+                        std::coroutine_handle<> handle) noexcept;
+
+//! Awaitable that continues a coroutine on a thread of an Executor
+class ScheduleAwaiter {
+  Executor& _executor;
+
+ public:
+  ScheduleAwaiter(Executor& executor) : _executor(executor) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> h) { post(_executor, h); }
+
+  void await_resume() const noexcept {}
+};
+
+/**
+ * Continue the calling coroutine on a thread of an Executor.
+ *
+ * @code
+ * co_await coro::schedule(pool);
+ * @endcode
+ *
+ * @exception Cancellation_Exception thrown in the coroutine if the Executor
+ *            has been canceled.
+ */
+inline ScheduleAwaiter schedule(Executor& executor) {
+  return ScheduleAwaiter(executor);
+}
+
+//! A suspended coroutine, in the list of those waiting on a Mutex or queue
+struct Waiter {
+  Waiter* next;
+  std::coroutine_handle<> handle;
+
+  //! Set if the coroutine is resumed because the queue was canceled
+  bool canceled;
+
+  Waiter() : next(0), canceled(false) {}
+};
+
+//! First in, first out list of Waiters, linked through the Waiters
+class WaitList {
+  Waiter* _head;
+  Waiter* _tail;
+
+ public:
+  WaitList() : _head(0), _tail(0) {}
+
+  bool empty() const { return _head == 0; }
+
+  void push(Waiter* w) {
+    w->next = 0;
+
+    if (_tail)
+      _tail->next = w;
+    else
+      _head = w;
+
+    _tail = w;
+  }
+
+  Waiter* pop() {
+    Waiter* w = _head;
+
+    if (w && (_head = w->next) == 0) _tail = 0;
+
+    return w;
+  }
+
+  //! Resume each Waiter removed from the list on an Executor
+  void resume(Executor& executor) {
+    while (Waiter* w = pop()) coro::resume(executor, w->handle);
+  }
+};
+
+/**
+ * @class Mutex
+ *
+ * A lock that suspends the coroutines waiting to acquire it. The lock is
+ * handed to waiters in the order they arrived, each resumed on the
+ * Executor given to the Mutex.
+ *
+ * @code
+ *
+ * co_await mutex.Acquire();
+ * ...
+ * mutex.Release();
+ *
+ * @endcode
+ */
+class ZTHREAD_API Mutex : private NonCopyable {
+  FastMutex _lock;
+  bool _locked;
+
+  WaitList _waiters;
+  Executor& _executor;
+
+ public:
+  class Awaiter : private Waiter {
+    Mutex& _mutex;
+
+   public:
+    Awaiter(Mutex& mutex) : _mutex(mutex) {}
+
+    bool await_ready() { return _mutex.TryAcquire(); }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+      handle = h;
+      return _mutex.wait(this);
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  /**
+   * Create a Mutex.
+   *
+   * @param executor Executor that resumes the coroutines that acquire the
+   *        Mutex after waiting for it
+   */
+  Mutex(Executor& executor);
+
+  ~Mutex();
+
+  //! Get an awaitable that acquires the Mutex
+  Awaiter Acquire() { return Awaiter(*this); }
+
+  //! Acquire the Mutex if it is free, without suspending
+  bool TryAcquire();
+
+  //! Release the Mutex, handing it to the first coroutine waiting for it
+  void Release();
+
+ private:
+  //! Add a waiter, unless the Mutex was released in the meantime
+  bool wait(Waiter* w);
+};
+
+/**
+ * @class AsyncQueue
+ *
+ * The queue behind BlockingQueue and BoundedQueue. Values added while a
+ * coroutine waits in Next() are handed straight to it; otherwise they are
+ * queued in the order they arrive.
+ */
+template <typename T>
+class AsyncQueue : private NonCopyable {
+  struct Taker : Waiter {
+    std::optional<T> item;
+  };
+
+  struct Adder : Waiter {
+    const T* item;
+  };
+
+  FastMutex _lock;
+  std::deque<T> _queue;
+
+  //! Coroutines waiting for a value, and to add one
+  WaitList _takers;
+  WaitList _adders;
+
+  Executor& _executor;
+  size_t _capacity;
+
+  bool _canceled;
+
+  //! Hand a value to a coroutine waiting for one, or queue it
+  //! @pre the lock is held
+  Waiter* put(const T& item) {
+    Taker* t = static_cast<Taker*>(_takers.pop());
+
+    if (t)
+      t->item.emplace(item);
+    else
+      _queue.push_back(item);
+
+    return t;
+  }
+
+  //! Take a value, or wait for one; false if none needs to be waited for
+  bool take(Taker* t) {
+    Waiter* w = 0;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      if (_queue.empty()) {
+        if (_canceled) return false;
+
+        _takers.push(t);
+        return true;
+      }
+
+      t->item.emplace(_queue.front());
+      _queue.pop_front();
+
+      // Make room for the first coroutine waiting to add a value
+      Adder* a = static_cast<Adder*>(_adders.pop());
+      if (a) _queue.push_back(*a->item);
+
+      w = a;
+    }
+
+    if (w) coro::resume(_executor, w->handle);
+
+    return false;
+  }
+
+  //! Add a value, or wait for room; false if there was room
+  bool add(Adder* a) {
+    Waiter* w = 0;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      if (_canceled) throw CancellationException();
+
+      if (_capacity > 0 && _queue.size() >= _capacity) {
+        _adders.push(a);
+        return true;
+      }
+
+      w = put(*a->item);
+    }
+
+    if (w) coro::resume(_executor, w->handle);
+
+    return false;
+  }
+
+ protected:
+  //! Add a value to a queue without a capacity
+  void push(const T& item) {
+    Waiter* w = 0;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      if (_canceled) throw CancellationException();
+
+      w = put(item);
+    }
+
+    if (w) coro::resume(_executor, w->handle);
+  }
+
+ public:
+  class NextAwaiter : private Taker {
+    AsyncQueue& _queue;
+
+   public:
+    NextAwaiter(AsyncQueue& queue) : _queue(queue) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+      this->handle = h;
+      return _queue.take(this);
+    }
+
+    T await_resume() {
+      if (!this->item) throw CancellationException();
+
+      return std::move(*this->item);
+    }
+  };
+
+  class AddAwaiter : private Adder {
+    AsyncQueue& _queue;
+    T _value;
+
+   public:
+    AddAwaiter(AsyncQueue& queue, const T& value)
+        : _queue(queue), _value(value) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h) {
+      this->handle = h;
+      this->item = &_value;
+
+      return _queue.add(this);
+    }
+
+    void await_resume() const {
+      if (this->canceled) throw CancellationException();
+    }
+  };
+
+  /**
+   * Create an AsyncQueue.
+   *
+   * @param executor Executor that resumes the coroutines that waited
+   * @param capacity most values queued at once, or 0 for no limit
+   */
+  AsyncQueue(Executor& executor, size_t capacity)
+      : _executor(executor), _capacity(capacity), _canceled(false) {}
+
+  /**
+   * Get an awaitable that retrieves and removes the next value, suspending
+   * the coroutine until one is available.
+   *
+   * @exception Cancellation_Exception thrown in the coroutine if the queue
+   *            is canceled and empty.
+   */
+  NextAwaiter Next() { return NextAwaiter(*this); }
+
+  /**
+   * Cancel the queue. Values can no longer be added; those already queued
+   * can still be retrieved, after which Next() throws. The coroutines
+   * waiting in Next() or Add() are resumed with a Cancellation_Exception.
+   */
+  void Cancel() {
+    WaitList woken;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      _canceled = true;
+
+      while (Waiter* w = _takers.pop()) woken.push(w);
+
+      while (Waiter* w = _adders.pop()) {
+        w->canceled = true;
+        woken.push(w);
+      }
+    }
+
+    woken.resume(_executor);
+  }
+
+  bool IsCanceled() {
+    Guard<FastMutex> g(_lock);
+    return _canceled;
+  }
+
+  size_t Size() {
+    Guard<FastMutex> g(_lock);
+    return _queue.size();
+  }
+};
+
+/**
+ * @class BlockingQueue
+ *
+ * An AsyncQueue without a capacity, whose Add() never suspends.
+ */
+template <typename T>
+class BlockingQueue : public AsyncQueue<T> {
+ public:
+  //! @param executor Executor that resumes the coroutines waiting in Next()
+  BlockingQueue(Executor& executor) : AsyncQueue<T>(executor, 0) {}
+
+  /**
+   * Add a value, resuming the first coroutine waiting for one.
+   *
+   * @exception Cancellation_Exception thrown if the queue was canceled.
+   */
+  void Add(const T& item) { this->push(item); }
+};
+
+/**
+ * @class BoundedQueue
+ *
+ * An AsyncQueue with a capacity; Add() suspends the coroutine while the
+ * queue is full.
+ *
+ * @code
+ * co_await queue.Add(item);
+ * @endcode
+ */
+template <typename T>
+class BoundedQueue : public AsyncQueue<T> {
+ public:
+  /**
+   * Create a BoundedQueue.
+   *
+   * @param executor Executor that resumes the coroutines that waited
+   * @param capacity most values queued at once
+   *
+   * @exception InvalidOp_Exception thrown if <i>capacity</i> is 0.
+   */
+  BoundedQueue(Executor& executor, size_t capacity)
+      : AsyncQueue<T>(executor, capacity) {
+    if (capacity == 0) throw InvalidOpException("Capacity must be positive");
+  }
+
+  /**
+   * Get an awaitable that adds a value, suspending the coroutine until
+   * there is room for it.
+   *
+   * @exception Cancellation_Exception thrown in the coroutine if the queue
+   *            is canceled before the value is added.
+   */
+  typename AsyncQueue<T>::AddAwaiter Add(const T& item) {
+    return typename AsyncQueue<T>::AddAwaiter(*this, item);
+  }
+};
+
+template <typename T>
+class Task;
+
+//! State shared by the promises of every Task
+class TaskPromiseBase {
+  //! Coroutine awaiting the Task, and where to resume it
+  std::coroutine_handle<> _continuation;
+  Executor* _executor;
+
+  std::exception_ptr _error;
+
+  template <typename T>
+  friend class Task;
+
+ protected:
+  void rethrow() {
+    if (_error) std::rethrow_exception(_error);
+  }
+
+ public:
+  class FinalAwaiter {
+   public:
+    bool await_ready() const noexcept { return false; }
+
+    template <typename P>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<P> h) noexcept {
+      TaskPromiseBase& p = h.promise();
+
+      if (!p._continuation) return std::noop_coroutine();
+
+      if (p._executor) {
+        coro::resume(*p._executor, p._continuation);
+        return std::noop_coroutine();
+      }
+
+      return p._continuation;
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  TaskPromiseBase() : _executor(0) {}
+
+  //! Tasks do not start until they are awaited
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+
+  void unhandled_exception() { _error = std::current_exception(); }
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+  std::optional<T> _value;
+
+ public:
+  Task<T> get_return_object();
+
+  void return_value(T value) { _value.emplace(std::move(value)); }
+
+  T result() {
+    rethrow();
+    return std::move(*_value);
+  }
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object();
+
+  void return_void() const noexcept {}
+
+  void result() { rethrow(); }
+};
+
+/**
+ * @class Task
+ *
+ * The result of a coroutine that completes with a value of type T. The
+ * coroutine starts when the Task is awaited, on the awaiting thread, and
+ * the awaiting coroutine continues once it completes, with its value or its
+ * exception. A Task is awaited at most once.
+ *
+ * By default the awaiting coroutine continues on the thread that completed
+ * the Task; via() has it continue on a thread of an Executor instead.
+ *
+ * @code
+ *
+ * coro::Task<int> length(coro::BlockingQueue<std::string>& q) {
+ *   std::string s = co_await q.Next();
+ *   co_return s.size();
+ * }
+ *
+ * int n = co_await length(q).via(pool);
+ *
+ * @endcode
+ */
+template <typename T>
+class Task : private NonCopyable {
+ public:
+  typedef TaskPromise<T> promise_type;
+
+ private:
+  std::coroutine_handle<promise_type> _handle;
+
+ public:
+  class Awaiter {
+    std::coroutine_handle<promise_type> _handle;
+
+   public:
+    Awaiter(std::coroutine_handle<promise_type> h) : _handle(h) {}
+
+    bool await_ready() const noexcept { return !_handle || _handle.done(); }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept {
+      _handle.promise()._continuation = h;
+      return _handle;
+    }
+
+    T await_resume() {
+      if (!_handle) throw InvalidOpException("Task has no coroutine");
+
+      return _handle.promise().result();
+    }
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> h) : _handle(h) {}
+
+  Task(Task&& other) noexcept : _handle(other._handle) { other._handle = 0; }
+
+  ~Task() {
+    if (_handle) _handle.destroy();
+  }
+
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      if (_handle) _handle.destroy();
+
+      _handle = other._handle;
+      other._handle = 0;
+    }
+
+    return *this;
+  }
+
+  //! Continue the awaiting coroutine on a thread of an Executor
+  Task& via(Executor& executor) & {
+    _handle.promise()._executor = &executor;
+    return *this;
+  }
+
+  Task&& via(Executor& executor) && {
+    _handle.promise()._executor = &executor;
+    return std::move(*this);
+  }
+
+  //! Test whether the coroutine has completed
+  bool isDone() const { return _handle && _handle.done(); }
+
+  Awaiter operator co_await() const noexcept { return Awaiter(_handle); }
+};
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<TaskPromise<T> >::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+  return Task<void>(
+      std::coroutine_handle<TaskPromise<void> >::from_promise(*this));
+}
+
+//! A coroutine that starts at once and is destroyed when it completes
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() const noexcept { return Detached(); }
+
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+
+    std::suspend_never final_suspend() const noexcept { return {}; }
+
+    void return_void() const noexcept {}
+
+    void unhandled_exception() const noexcept {}
+  };
+};
+
+template <typename T>
+Detached launch(Executor& executor, Task<T> task, Promise<T> promise) {
+  try {
+    co_await schedule(executor);
+    promise.set(co_await task);
+
+  } catch (const SynchronizationException& e) {
+    promise.fail(e.what());
+  } catch (const std::exception& e) {
+    promise.fail(e.what());
+  } catch (...) {
+    promise.fail("Coroutine failed");
+  }
+}
+
+inline Detached launch(Executor& executor, Task<void> task) {
+  try {
+    co_await schedule(executor);
+    co_await task;
+
+  } catch (...) {
+    /* consume the exceptions the work propogates */
+  }
+}
+
+/**
+ * Start a Task on a thread of an Executor, and get its result as a Future.
+ * T must be default constructible and assignable.
+ */
+template <typename T>
+Future<T> spawn(Executor& executor, Task<T> task) {
+  Promise<T> promise;
+  launch(executor, std::move(task), promise);
+
+  return promise.getFuture();
+}
+
+/**
+ * Start a Task on a thread of an Executor. As with the tasks an Executor
+ * runs, an exception the coroutine propagates is consumed.
+ */
+inline void spawn(Executor& executor, Task<void> task) {
+  launch(executor, std::move(task));
+}
+
+}  // namespace coro
+
+}  // namespace zthread
+
+#endif  // __ZTCOROUTINE_H__
@@ -205,6 +205,20 @@ class FutureException : public SynchronizationException {
   //! Create a new exception
   FutureException(const char* msg) : SynchronizationException(msg) {}
 };
+
+/**
+ * @class RejectedException
+ *
+ * Thrown when an Executor that has reached its capacity turns a task away.
+ */
+class RejectedException : public SynchronizationException {
+ public:
+  //! Create a new exception
+  RejectedException() : SynchronizationException("Task rejected") {}
+
+  //! Create a new exception
+  RejectedException(const char* msg) : SynchronizationException(msg) {}
+};
 }; // namespace zthread
 
 #endif  // __ZTEXCEPTIONS_H__
@@ -90,6 +90,21 @@ class Executor : public Cancelable, public Waitable, private NonCopyable {
    * to the invocation of this function.
    */
   virtual void Execute(const Task& task) = 0;
+
+  /**
+   * Submit a batch of tasks to this Executor. Executors that queue their
+   * tasks accept the whole batch at once, which is cheaper than submitting
+   * each task in turn; by default each task is simply execute()d.
+   *
+   * @param begin first task to be run
+   * @param end   one past the last task to be run
+   *
+   * @exception CancellationException thrown if the Executor was canceled prior
+   * to the invocation of this function.
+   */
+  virtual void ExecuteAll(const Task* begin, const Task* end) {
+    for (; begin != end; ++begin) Execute(*begin);
+  }
 };
 
 }  // namespace zthread
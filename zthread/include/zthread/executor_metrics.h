@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTEXECUTORMETRICS_H__
+#define __ZTEXECUTORMETRICS_H__
+
+#include <stddef.h>
+#include <vector>
+
+namespace zthread {
+
+/**
+ * @class ExecutorMetrics
+ *
+ * A snapshot of the activity of an executor, as returned by
+ * PoolExecutor::getMetrics(), ThreadedExecutor::getMetrics() and
+ * ConcurrentExecutor::getMetrics(). Counters accumulate from the time the
+ * executor was created; durations are in microseconds.
+ *
+ * The figures are gathered from each worker without stopping the executor,
+ * so while tasks are running they may not add up exactly.
+ */
+class ExecutorMetrics {
+ public:
+  enum { BUCKETS = 32 };
+
+  /**
+   * @class Histogram
+   *
+   * Distribution of durations over power of two buckets: bucket 0 holds
+   * durations under 1us, and bucket i those from 2^(i-1) up to 2^i us.
+   */
+  class Histogram {
+   public:
+    unsigned long count[BUCKETS];
+
+    //! Sum of the durations
+    unsigned long total;
+
+    Histogram() : total(0) {
+      for (size_t i = 0; i < BUCKETS; ++i) count[i] = 0;
+    }
+
+    //! Number of durations recorded
+    unsigned long samples() const {
+      unsigned long n = 0;
+      for (size_t i = 0; i < BUCKETS; ++i) n += count[i];
+
+      return n;
+    }
+
+    //! Mean duration, 0 if none were recorded
+    unsigned long mean() const {
+      unsigned long n = samples();
+      return n == 0 ? 0 : total / n;
+    }
+
+    /**
+     * Estimate a percentile.
+     *
+     * @param p percentile, from 0 to 100
+     * @return unsigned long upper bound of the bucket the percentile falls
+     *         in, 0 if no durations were recorded
+     */
+    unsigned long percentile(double p) const {
+      unsigned long n = samples();
+      if (n == 0) return 0;
+
+      unsigned long rank = (unsigned long)(p / 100.0 * n);
+      if (rank >= n) rank = n - 1;
+
+      size_t i = 0;
+      for (unsigned long seen = count[0]; seen <= rank; seen += count[++i])
+        ;
+
+      return 1UL << i;
+    }
+
+    Histogram& operator+=(const Histogram& h) {
+      for (size_t i = 0; i < BUCKETS; ++i) count[i] += h.count[i];
+      total += h.total;
+
+      return *this;
+    }
+  };
+
+  /**
+   * @class Worker
+   *
+   * Activity of a single worker of a pool. A worker that exits leaves its
+   * figures to the next worker started.
+   */
+  class Worker {
+   public:
+    unsigned long completed;
+    unsigned long failed;
+
+    //! Time spent running tasks, and waiting for them
+    unsigned long busy;
+    unsigned long idle;
+
+    //! Set while a thread is attached, and while it runs a task
+    bool active;
+    bool running;
+
+    Worker()
+        : completed(0),
+          failed(0),
+          busy(0),
+          idle(0),
+          active(false),
+          running(false) {}
+  };
+
+  //! Tasks waiting to start, the most that ever were, and tasks running
+  size_t queued;
+  size_t peakQueued;
+  size_t running;
+
+  //! Tasks that returned, and tasks that propagated an exception
+  unsigned long completed;
+  unsigned long failed;
+
+  //! Tasks a full pool turned away, dropped to make room, and left to
+  //! their submitter to run
+  unsigned long rejected;
+  unsigned long dropped;
+  unsigned long callerRan;
+
+  //! Time from submission until a task starts, and time it runs for
+  Histogram queueDelay;
+  Histogram runTime;
+
+  //! Time the workers spent running tasks, and waiting for them
+  unsigned long busy;
+  unsigned long idle;
+
+  //! Workers of a pool; a ThreadedExecutor reports none
+  std::vector<Worker> workers;
+
+  ExecutorMetrics()
+      : queued(0),
+        peakQueued(0),
+        running(0),
+        completed(0),
+        failed(0),
+        rejected(0),
+        dropped(0),
+        callerRan(0),
+        busy(0),
+        idle(0) {}
+
+  /**
+   * Get the fraction of the time the workers were busy.
+   *
+   * @return double from 0 to 1, 0 if no time has been recorded
+   */
+  double utilization() const {
+    unsigned long t = busy + idle;
+    return t == 0 ? 0.0 : (double)busy / t;
+  }
+};
+
+}  // namespace zthread
+
+#endif  // __ZTEXECUTORMETRICS_H__
@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFUTURE_H__
+#define __ZTFUTURE_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/exceptions.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/future_impl.h"
+#include "zthread/guard.h"
+
+#include <vector>
+
+namespace zthread {
+
+template <typename T>
+class Promise;
+
+/**
+ * @class FutureValue
+ *
+ * A FutureImpl that holds a value of type T. T must be default
+ * constructible and assignable.
+ */
+template <typename T>
+class FutureValue : public FutureImpl {
+  T _value;
+
+ public:
+  FutureValue() : _value() {}
+
+  //! Get the value, once the future is done
+  const T& value() const { return _value; }
+
+  /**
+   * Complete the future with a value.
+   *
+   * @return bool false if the future had already been completed
+   */
+  bool set(const T& value) {
+    if (!claim()) return false;
+
+    _value = value;
+    complete();
+
+    return true;
+  }
+};
+
+/**
+ * @class Future
+ *
+ * The result of a computation that may not have completed yet. A Future is
+ * completed once, through its Promise, with either a value or a failure.
+ * Copies of a Future refer to the same result.
+ *
+ * A thread can block for the result with get(), or arrange for a task to be
+ * submitted to an Executor once the result is available with then(), which
+ * does not hold any thread while the result is pending.
+ *
+ * @code
+ *
+ * int length(Future<std::string>& f) { return f.get().size(); }
+ *
+ * Promise<std::string> p;
+ * Future<int> n = p.getFuture().then<int>(executor, length);
+ *
+ * p.set("hello");
+ * n.get();  // 5, computed by one of the executor's threads
+ *
+ * @endcode
+ *
+ * @see Promise
+ */
+template <typename T>
+class Future {
+  typedef CountedPtr<FutureValue<T>, AtomicCount> ValuePtr;
+
+  friend class Promise<T>;
+
+  ValuePtr _impl;
+
+  Future(const ValuePtr& impl) : _impl(impl) {}
+
+  const T& result() {
+    if (_impl->isFailed()) throw FutureException(_impl->error());
+
+    return _impl->value();
+  }
+
+ public:
+  typedef T ValueType;
+
+  //! Test whether the result is available, or the computation failed
+  bool isDone() { return _impl->isDone(); }
+
+  //! Test whether the computation failed
+  bool isFailed() { return _impl->isFailed(); }
+
+  /**
+   * Block the calling thread until the result is available.
+   *
+   * @exception FutureException thrown if the computation failed, with the
+   *            reason it failed
+   * @exception InterruptedException thrown if the calling thread is
+   *            interrupted before the result is available
+   */
+  const T& get() {
+    _impl->wait();
+    return result();
+  }
+
+  /**
+   * Block the calling thread until the result is available, or until the
+   * timeout (milliseconds) expires.
+   *
+   * @exception TimeoutException thrown if the timeout expired first
+   * @exception FutureException thrown if the computation failed
+   * @exception InterruptedException thrown if the calling thread is
+   *            interrupted before the result is available
+   */
+  const T& get(unsigned long timeout) {
+    if (!_impl->wait(timeout)) throw TimeoutException();
+
+    return result();
+  }
+
+  /**
+   * Submit a task to an Executor once this Future is done. The task is
+   * dropped if the Executor rejects it.
+   *
+   * @pre the Executor remains valid until this Future is done
+   */
+  void then(Executor& executor, const Task& task) {
+    _impl->execute(executor, task);
+  }
+
+  /**
+   * Compute a new result from this one on an Executor, once this Future is
+   * done. The function is called as <i>U fn(Future<T>&)</i>; a
+   * SynchronizationException it throws, including the FutureException
+   * thrown by get() if this Future failed, fails the new Future. The new
+   * Future also fails if the Executor rejects the computation.
+   *
+   * @pre the Executor remains valid until this Future is done
+   */
+  template <typename U, typename Fn>
+  Future<U> then(Executor& executor, Fn fn);
+
+  /**
+   * Notify a listener once this Future is done, on the thread that
+   * completes it or, if it is already done, on the calling thread. The
+   * Future takes ownership of the listener until it is notified.
+   */
+  void listen(FutureImpl::Listener* l) { _impl->listen(l); }
+};
+
+/**
+ * @class PromiseState
+ *
+ * Shared by the copies of a Promise; the Future fails once the last of them
+ * is released without completing it.
+ */
+template <typename T>
+class PromiseState : private NonCopyable {
+ public:
+  CountedPtr<FutureValue<T>, AtomicCount> future;
+
+  PromiseState() : future(new FutureValue<T>) {}
+
+  ~PromiseState() { future->fail("Broken promise"); }
+};
+
+/**
+ * @class Promise
+ *
+ * Completes a Future. Only the first attempt to complete it has any
+ * effect. Copies of a Promise refer to the same Future, which fails if
+ * every copy is released before it is completed.
+ *
+ * @see Future
+ */
+template <typename T>
+class Promise {
+  CountedPtr<PromiseState<T>, AtomicCount> _state;
+
+ public:
+  //! Create a Promise for a new Future
+  Promise() : _state(new PromiseState<T>) {}
+
+  //! Get the Future this Promise completes
+  Future<T> getFuture() { return Future<T>(_state->future); }
+
+  /**
+   * Complete the Future with a value.
+   *
+   * @return bool false if the Future had already been completed
+   */
+  bool set(const T& value) { return _state->future->set(value); }
+
+  /**
+   * Complete the Future as failed; get() will throw a FutureException with
+   * the given message.
+   *
+   * @return bool false if the Future had already been completed
+   */
+  bool fail(const char* msg) { return _state->future->fail(msg); }
+
+  //! Test whether the Future has been completed
+  bool isDone() { return _state->future->isDone(); }
+};
+
+/**
+ * @class Continuation
+ *
+ * Task submitted by Future::then() to compute a new result.
+ */
+template <typename T, typename U, typename Fn>
+class Continuation : public Runnable {
+  Future<T> _source;
+  Promise<U> _result;
+  Fn _fn;
+
+ public:
+  Continuation(const Future<T>& source, const Promise<U>& result, Fn fn)
+      : _source(source), _result(result), _fn(fn) {}
+
+  void run() {
+    try {
+      _result.set(_fn(_source));
+    } catch (const SynchronizationException& e) {
+      _result.fail(e.what());
+    } catch (...) {
+      _result.fail("Continuation failed");
+    }
+  }
+};
+
+template <typename T>
+template <typename U, typename Fn>
+Future<U> Future<T>::then(Executor& executor, Fn fn) {
+  Promise<U> result;
+
+  // A continuation the executor drops releases the last copy of the
+  // Promise, which fails the new Future
+  then(executor, Task(new Continuation<T, U, Fn>(*this, result, fn)));
+
+  return result.getFuture();
+}
+
+/**
+ * @class WhenAllListener
+ *
+ * Collects the result of one of the inputs to whenAll().
+ */
+template <typename T>
+class WhenAllListener : public FutureImpl::Listener {
+ public:
+  //! Shared by the listeners of a single whenAll()
+  struct State {
+    FastMutex lock;
+    std::vector<T> values;
+    size_t remaining;
+    Promise<std::vector<T> > result;
+
+    State(size_t n) : values(n), remaining(n) {}
+  };
+
+ private:
+  CountedPtr<State, AtomicCount> _state;
+  Future<T> _input;
+  size_t _index;
+
+ public:
+  WhenAllListener(const CountedPtr<State, AtomicCount>& state,
+                  const Future<T>& input, size_t index)
+      : _state(state), _input(input), _index(index) {}
+
+  void complete() {
+    try {
+      const T& value = _input.get();
+      bool last;
+
+      {
+        Guard<FastMutex> g(_state->lock);
+
+        _state->values[_index] = value;
+        last = --_state->remaining == 0;
+      }
+
+      if (last) _state->result.set(_state->values);
+
+    } catch (const SynchronizationException& e) {
+      // The first input to fail fails the result
+      _state->result.fail(e.what());
+    }
+
+    delete this;
+  }
+};
+
+/**
+ * Combine the results of several Futures.
+ *
+ * @return Future that completes with the value of each input, in order,
+ *         once all of them are available, or fails as soon as any of them
+ *         fails.
+ */
+template <typename T>
+Future<std::vector<T> > whenAll(const std::vector<Future<T> >& inputs) {
+  typedef typename WhenAllListener<T>::State State;
+  CountedPtr<State, AtomicCount> state(new State(inputs.size()));
+
+  Future<std::vector<T> > result = state->result.getFuture();
+
+  if (inputs.empty()) state->result.set(std::vector<T>());
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    Future<T> input(inputs[i]);
+    input.listen(new WhenAllListener<T>(state, input, i));
+  }
+
+  return result;
+}
+
+/**
+ * @class WhenAnyListener
+ *
+ * Reports one of the inputs to whenAny() as it completes.
+ */
+class WhenAnyListener : public FutureImpl::Listener {
+  CountedPtr<Promise<size_t>, AtomicCount> _result;
+  size_t _index;
+
+ public:
+  WhenAnyListener(const CountedPtr<Promise<size_t>, AtomicCount>& result,
+                  size_t index)
+      : _result(result), _index(index) {}
+
+  void complete() {
+    _result->set(_index);
+    delete this;
+  }
+};
+
+/**
+ * Wait for the first of several Futures.
+ *
+ * @return Future that completes with the index of the first input to be
+ *         done, whether it succeeded or failed. It fails if there are no
+ *         inputs.
+ */
+template <typename T>
+Future<size_t> whenAny(const std::vector<Future<T> >& inputs) {
+  CountedPtr<Promise<size_t>, AtomicCount> result(new Promise<size_t>);
+  Future<size_t> future = result->getFuture();
+
+  if (inputs.empty()) result->fail("No futures to wait for");
+
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    Future<T> input(inputs[i]);
+    input.listen(new WhenAnyListener(result, i));
+  }
+
+  return future;
+}
+
+}  // namespace zthread
+
+#endif  // __ZTFUTURE_H__
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTFUTUREIMPL_H__
+#define __ZTFUTUREIMPL_H__
+
+#include "zthread/executor.h"
+#include "zthread/non_copyable.h"
+
+#include <string>
+
+namespace zthread {
+
+/**
+ * @class FutureImpl
+ *
+ * The type independent part of a Future: its state, the threads waiting
+ * for it and the listeners to notify once it completes.
+ *
+ * Completing a FutureImpl is a lock-free state transition. Listeners are
+ * kept on a lock-free stack that is closed, atomically, as the future
+ * completes, so each listener is notified exactly once whether it was added
+ * before or after completion. Waiting threads are listeners that park on
+ * their own thread Monitor.
+ *
+ * @see Future
+ */
+class ZTHREAD_API FutureImpl : private NonCopyable {
+ public:
+  /**
+   * @class Listener
+   *
+   * Notified once, by the thread that completes the future. The future does
+   * not touch or delete a Listener after calling complete(); Listeners that
+   * are never notified are deleted with the future.
+   */
+  class Listener {
+    friend class FutureImpl;
+    Listener* _next;
+
+   public:
+    Listener() : _next(0) {}
+
+    virtual ~Listener() {}
+
+    //! The future has completed, successfully or not
+    virtual void complete() = 0;
+
+    //! Test whether the listener no longer wants to be notified
+    virtual bool abandoned() { return false; }
+  };
+
+ private:
+  volatile long _state;
+
+  Listener* volatile _listeners;
+
+  //! Listeners abandoned since the list was last swept
+  volatile long _abandoned;
+
+  //! Reason the future failed
+  std::string _error;
+
+  bool push(Listener*);
+
+  void reclaim();
+
+  void publish(long state);
+
+ public:
+  //! Create a pending FutureImpl
+  FutureImpl();
+
+  //! Destroy a FutureImpl and the listeners it never notified
+  virtual ~FutureImpl();
+
+  //! Test whether the future has completed, successfully or not
+  bool isDone();
+
+  //! Test whether the future has failed
+  bool isFailed();
+
+  //! Get the reason the future failed
+  const char* error();
+
+  /**
+   * Claim the right to complete the future. The thread that succeeds must
+   * store the result and then call complete().
+   *
+   * @return bool false if the future has already been claimed
+   */
+  bool claim();
+
+  //! Complete a claimed future and notify its listeners
+  void complete();
+
+  /**
+   * Complete the future as failed.
+   *
+   * @return bool false if the future had already been claimed
+   */
+  bool fail(const char* msg);
+
+  /**
+   * Block the calling thread until the future completes.
+   *
+   * @exception InterruptedException thrown if the calling thread is
+   *            interrupted first
+   */
+  void wait();
+
+  /**
+   * Block the calling thread until the future completes or the timeout
+   * (milliseconds) expires. A thread interrupted as the future completes
+   * returns normally and keeps its interrupted status.
+   *
+   * @return bool false if the timeout expired
+   * @exception InterruptedException thrown if the calling thread is
+   *            interrupted first
+   */
+  bool wait(unsigned long timeout);
+
+  //! Notify the listener once the future completes, immediately if it has
+  void listen(Listener*);
+
+  /**
+   * Submit a task to an Executor once the future completes. The task is
+   * dropped if the Executor rejects it.
+   *
+   * @pre the Executor remains valid until the future completes
+   */
+  void execute(Executor&, const Task&);
+};
+
+}  // namespace zthread
+
+#endif  // __ZTFUTUREIMPL_H__
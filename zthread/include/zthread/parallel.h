@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTPARALLEL_H__
+#define __ZTPARALLEL_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/parallel_impl.h"
+#include "zthread/pool_executor.h"
+
+#include <vector>
+
+namespace zthread {
+
+/**
+ * @class ParallelFor
+ *
+ * A ParallelImpl that runs a loop body over each chunk it is handed.
+ */
+template <typename Body>
+class ParallelFor : public ParallelImpl {
+  Body _body;
+
+ protected:
+  virtual void invoke(size_t, size_t first, size_t last) {
+    _body(first, last);
+  }
+
+ public:
+  ParallelFor(size_t begin, size_t end, size_t grain, size_t participants,
+              const Body& body)
+      : ParallelImpl(begin, end, grain, participants), _body(body) {}
+};
+
+/**
+ * @class ParallelReduce
+ *
+ * A ParallelImpl that folds each chunk it is handed into a partial result
+ * kept for the thread running it. Each partial is only ever written by
+ * the thread that owns its slot, so no lock is needed until the partials
+ * are combined by the caller.
+ */
+template <typename T, typename Body>
+class ParallelReduce : public ParallelImpl {
+  Body _body;
+  std::vector<T> _partials;
+
+ protected:
+  virtual void invoke(size_t slot, size_t first, size_t last) {
+    _partials[slot] = _body(first, last, _partials[slot]);
+  }
+
+ public:
+  ParallelReduce(size_t begin, size_t end, size_t grain, size_t participants,
+                 const T& identity, const Body& body)
+      : ParallelImpl(begin, end, grain, participants),
+        _body(body),
+        _partials(participants, identity) {}
+
+  //! Get the partial results, once the loop is done
+  const std::vector<T>& partials() const { return _partials; }
+};
+
+/**
+ * Run a loop body over the range [begin, end) using the threads of a
+ * PoolExecutor, with the calling thread taking part.
+ *
+ * The range is split into chunks of at least <i>grain</i> indices, which
+ * are handed out as threads become free; chunks start large and shrink as
+ * the range runs out, so a few expensive indices do not hold up the rest.
+ * The body is called as body(first, last) for each chunk, and must be safe
+ * to call from several threads at once.
+ *
+ * The call returns once every index has been run. Since the caller works
+ * through the range itself, it is safe to call from a task running in the
+ * same pool, even one that has no idle threads.
+ *
+ * @code
+ *
+ * struct Scale {
+ *   float* v;
+ *   void operator()(size_t first, size_t last) const {
+ *     for (size_t i = first; i < last; ++i) v[i] *= 2;
+ *   }
+ * };
+ *
+ * Scale s = {v};
+ * parallelFor(pool, 0, n, 4096, s);
+ *
+ * @endcode
+ *
+ * @param pool executor whose threads help with the loop
+ * @param begin first index
+ * @param end one past the last index
+ * @param grain smallest number of indices handed to the body at once
+ * @param body loop body
+ *
+ * @exception SynchronizationException thrown with the reason if the body
+ *            failed on a thread of the pool; an exception the body throws
+ *            on the calling thread is propagated as is. Indices not yet
+ *            handed out when the body fails are skipped.
+ */
+template <typename Body>
+void parallelFor(PoolExecutor& pool, size_t begin, size_t end, size_t grain,
+                 const Body& body) {
+  if (begin >= end) return;
+
+  size_t helpers = ParallelImpl::helpers(pool.size(), end - begin, grain);
+  if (helpers == 0) {
+    Body b(body);
+    b(begin, end);
+
+    return;
+  }
+
+  CountedPtr<ParallelImpl> impl(
+      new ParallelFor<Body>(begin, end, grain, helpers + 1, body));
+
+  ParallelImpl::run(impl, pool, helpers);
+}
+
+/**
+ * Reduce the range [begin, end) to a single value using the threads of a
+ * PoolExecutor, with the calling thread taking part.
+ *
+ * Each thread taking part starts from <i>identity</i> and folds the chunks
+ * it is handed into its own partial result, as acc = body(first, last,
+ * acc). The partials are combined on the calling thread, once the loop is
+ * done, with combine(a, b). The order in which chunks are folded and
+ * partials are combined is unspecified, so combine must be associative and
+ * commutative, and identity must leave any value unchanged under it.
+ *
+ * @code
+ *
+ * struct Sum {
+ *   const double* v;
+ *   double operator()(size_t first, size_t last, double acc) const {
+ *     for (size_t i = first; i < last; ++i) acc += v[i];
+ *     return acc;
+ *   }
+ * };
+ *
+ * Sum s = {v};
+ * double total = parallelReduce(pool, 0, n, 4096, 0.0, s, std::plus<double>());
+ *
+ * @endcode
+ *
+ * @param pool executor whose threads help with the loop
+ * @param begin first index
+ * @param end one past the last index
+ * @param grain smallest number of indices handed to the body at once
+ * @param identity initial value of each partial result
+ * @param body folds a chunk into a partial result
+ * @param combine combines two partial results
+ *
+ * @return T the combined result, or identity for an empty range
+ *
+ * @exception SynchronizationException thrown as for parallelFor()
+ */
+template <typename T, typename Body, typename Combine>
+T parallelReduce(PoolExecutor& pool, size_t begin, size_t end, size_t grain,
+                 const T& identity, const Body& body, const Combine& combine) {
+  if (begin >= end) return identity;
+
+  size_t helpers = ParallelImpl::helpers(pool.size(), end - begin, grain);
+  if (helpers == 0) {
+    Body b(body);
+    return b(begin, end, identity);
+  }
+
+  ParallelReduce<T, Body>* reduce =
+      new ParallelReduce<T, Body>(begin, end, grain, helpers + 1, identity,
+                                  body);
+  CountedPtr<ParallelImpl> impl(reduce);
+
+  ParallelImpl::run(impl, pool, helpers);
+
+  const std::vector<T>& partials = reduce->partials();
+
+  Combine c(combine);
+
+  T result(partials[0]);
+  for (size_t i = 1; i < partials.size(); ++i) result = c(result, partials[i]);
+
+  return result;
+}
+
+}  // namespace zthread
+
+#endif  // __ZTPARALLEL_H__
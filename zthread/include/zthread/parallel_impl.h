@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTPARALLELIMPL_H__
+#define __ZTPARALLELIMPL_H__
+
+#include "zthread/condition.h"
+#include "zthread/counted_ptr.h"
+#include "zthread/executor.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/non_copyable.h"
+
+#include <string>
+
+namespace zthread {
+
+/**
+ * @class ParallelImpl
+ *
+ * The state shared by the threads taking part in a parallelFor() or a
+ * parallelReduce(). The range is handed out in chunks claimed from a shared
+ * cursor with a compare and swap. Each chunk is a share of what remains, but
+ * never smaller than the grain, so chunks are large while there is plenty
+ * left and shrink towards the end, which evens out skewed per-element
+ * costs.
+ *
+ * Subclasses provide the loop body through invoke().
+ */
+class ZTHREAD_API ParallelImpl : private NonCopyable {
+  //! Next index to hand out, and the end of the range
+  volatile size_t _next;
+  size_t _end;
+
+  size_t _grain;
+
+  //! Threads that may take part, and the number that have
+  size_t _participants;
+  volatile size_t _joined;
+
+  //! Elements not yet done or skipped
+  volatile size_t _remaining;
+
+  FastMutex _lock;
+  Condition _finished;
+
+  bool _done;
+
+  //! Set by the first failure, with its reason
+  volatile bool _failed;
+  std::string _error;
+
+  bool claim(size_t& first, size_t& last);
+
+  void finish(size_t n);
+
+  void fail(const char* error);
+
+  void wait();
+
+ protected:
+  /**
+   * Run the loop body over part of the range.
+   *
+   * @param slot index, below participants(), of the thread running it; no
+   *        two threads share a slot
+   * @param first first index
+   * @param last one past the last index
+   */
+  virtual void invoke(size_t slot, size_t first, size_t last) = 0;
+
+ public:
+  /**
+   * Create the state for a loop.
+   *
+   * @param begin first index
+   * @param end one past the last index
+   * @param grain smallest number of indices handed out at once
+   * @param participants threads that may take part, including the caller
+   */
+  ParallelImpl(size_t begin, size_t end, size_t grain, size_t participants);
+
+  virtual ~ParallelImpl();
+
+  size_t participants() const { return _participants; }
+
+  /**
+   * Claim and run chunks until none remain, or until the loop fails.
+   *
+   * @param rethrow true to propagate an exception thrown by the loop body,
+   *        once it has been recorded
+   */
+  void participate(bool rethrow);
+
+  /**
+   * Get the number of threads worth adding to the caller's own.
+   *
+   * @param workers threads the executor runs tasks with
+   * @param n number of indices
+   * @param grain smallest number of indices handed out at once
+   */
+  static size_t helpers(size_t workers, size_t n, size_t grain);
+
+  /**
+   * Run a loop: submit the helpers to the executor, take part from the
+   * calling thread, and wait until every chunk has been run. A helper
+   * that the executor does not get around to in time finds nothing left
+   * to do. Interrupting the calling thread does not cut the loop short;
+   * the thread is still interrupted once the loop returns.
+   *
+   * @exception SynchronizationException thrown with the reason if the loop
+   *            body failed on another thread; an exception thrown by the
+   *            body on the calling thread is propagated as is
+   */
+  static void run(CountedPtr<ParallelImpl> impl, Executor& executor,
+                  size_t helpers);
+};
+
+}  // namespace zthread
+
+#endif  // __ZTPARALLELIMPL_H__
@@ -27,8 +27,11 @@
 #ifndef __ZTPOOLEXECUTOR_H__
 #define __ZTPOOLEXECUTOR_H__
 
+#include "zthread/cancellation_token.h"
 #include "zthread/counted_ptr.h"
 #include "zthread/executor.h"
+#include "zthread/executor_metrics.h"
+#include "zthread/priority.h"
 #include "zthread/thread.h"
 
 namespace zthread {
@@ -58,6 +61,41 @@ class ExecutorImpl;
  * function
  *   have completed.
  *
+ * <b>Scheduling</b>
+ *
+ * By default every worker draws tasks from a single shared queue, and tasks
+ * are started in the order they were submitted. A pool created in the
+ * <i>WorkStealing</i> mode gives each worker its own deque instead. Tasks
+ * submitted by a task running in the pool go to that worker's deque and are
+ * run most recent first; tasks submitted from other threads go to a shared
+ * queue. Idle workers steal the oldest tasks of other workers. This suits
+ * tasks that fan out into many small subtasks, but no ordering between tasks
+ * is guaranteed.
+ *
+ * The <i>LockFree</i> mode keeps a single shared queue, but a worker that is
+ * busy takes its next task without a lock, and a submitter only pays for a
+ * wakeup when a worker is actually parked. This shortens the time from
+ * submission to start while the workers are busy.
+ *
+ * The <i>Prioritized</i> mode starts the tasks submitted with a higher
+ * Priority first, and tasks of the same Priority in the order they were
+ * submitted. Setting an aging() interval lets tasks that have been waiting
+ * for a long time overtake more urgent ones that arrived later, so that
+ * low priority work is not starved.
+ *
+ * In every mode, the wakeOrder() decides which parked worker a new task
+ * wakes.
+ *
+ * <b>Capacity</b>
+ *
+ * By default any number of tasks may wait for a worker. Setting a
+ * capacity() bounds the tasks waiting, in any scheduling mode, and the
+ * saturation() policy decides what becomes of a task submitted to a full
+ * pool: the submitter can <i>Block</i> until there is room, run the task
+ * itself (<i>CallerRuns</i>), have it turned away (<i>Reject</i>), or make
+ * room by dropping the task that has waited the longest (<i>DropOldest</i>).
+ * The number of tasks each policy affected is reported by getMetrics().
+ *
  * @see Executor.
  */
 class PoolExecutor : public Executor {
@@ -68,12 +106,59 @@ class PoolExecutor : public Executor {
   Task _shutdown;
 
  public:
+  //! How submitted tasks are handed to the worker threads
+  typedef enum {
+    //! Every worker draws from one shared queue
+    SharedQueue,
+    //! Every worker owns a deque, idle workers steal from the others
+    WorkStealing,
+    //! Every worker draws from one shared lock-free queue
+    LockFree,
+    //! Every worker draws the most urgent task from per-priority queues
+    Prioritized
+  } Scheduling;
+
+  //! What becomes of a task submitted while the pool is at its capacity
+  typedef enum {
+    //! The submitter waits for room, up to the saturation timeout
+    Block,
+    //! The submitter runs the task itself
+    CallerRuns,
+    //! The task is turned away with a RejectedException
+    Reject,
+    //! The task that has waited the longest is dropped, it is never run
+    DropOldest
+  } Saturation;
+
+  //! Which idle thread a newly submitted task wakes
+  typedef enum {
+    //! The thread that has been idle the longest
+    LongestIdle,
+    //! The thread that became idle most recently
+    MostRecentlyIdle
+  } WakeOrder;
+
   /**
    * Create a PoolExecutor
    *
    * @param n number of threads to service tasks with
+   * @param mode how tasks are handed to those threads
    */
-  PoolExecutor(size_t n);
+  PoolExecutor(size_t n, Scheduling mode = SharedQueue);
+
+  /**
+   * Create an elastic PoolExecutor. It keeps <i>core</i> threads, and adds
+   * threads up to <i>max</i> while submitted tasks outnumber the threads
+   * waiting for them. Threads beyond the core size exit once they have been
+   * idle for <i>timeout</i> milliseconds.
+   *
+   * @param core number of threads kept while the pool is idle
+   * @param max number of threads the pool may grow to
+   * @param timeout time (milliseconds) a surplus thread may idle
+   * @param mode how tasks are handed to those threads
+   */
+  PoolExecutor(size_t core, size_t max, unsigned long timeout,
+               Scheduling mode = SharedQueue);
 
   //! Destroy a PoolExecutor
   virtual ~PoolExecutor();
@@ -110,6 +195,121 @@ class PoolExecutor : public Executor {
    */
   size_t size();
 
+  /**
+   * Allow the pool to grow beyond its size() while tasks are backed up.
+   * Threads beyond size() exit after idling for idleTimeout() milliseconds,
+   * which is also how a pool whose size() is reduced sheds threads.
+   *
+   * @param n number of threads the pool may grow to, a value no greater
+   *        than size() keeps the pool at a fixed size.
+   */
+  void maxSize(size_t n);
+
+  //! Get the number of threads the pool may grow to
+  size_t maxSize();
+
+  /**
+   * Set the time (milliseconds) a thread beyond size() may idle before it
+   * exits. The default is one minute.
+   */
+  void idleTimeout(unsigned long timeout);
+
+  //! Get the time (milliseconds) a thread beyond size() may idle
+  unsigned long idleTimeout();
+
+  /**
+   * Set the time (microseconds) an idle thread polls for a new task before
+   * it parks. It then polls a few times more, yielding the processor in
+   * between, so a submitter sharing its processor gets to run. A task
+   * submitted meanwhile is left to the polling thread, sparing the cost of
+   * waking a parked one. This only pays off while there are processors to
+   * spare for the polling; the default of 0 parks at once.
+   */
+  void idleSpin(unsigned long usec);
+
+  //! Get the time (microseconds) an idle thread polls before it parks
+  unsigned long idleSpin();
+
+  /**
+   * Allow up to n spare threads to stand in for workers whose tasks block
+   * in a Mutex, Condition, Semaphore, Future, sleep() or any other of the
+   * library's blocking operations while tasks are left waiting, so that
+   * tasks waiting on one another cannot starve the pool. A spare exits once
+   * the worker it stood in for resumes. The default, 0, starts none.
+   */
+  void compensation(size_t n);
+
+  //! Get the most spare threads that may stand in for blocked workers
+  size_t compensation();
+
+  /**
+   * Set the aging interval (milliseconds) of a <i>Prioritized</i> pool.
+   * Each level of Priority is then worth one interval of waiting: a task
+   * starts before a more urgent task that was submitted more than that many
+   * intervals after it. The default, 0, disables aging.
+   */
+  void aging(unsigned long interval);
+
+  //! Get the aging interval (milliseconds), 0 if aging is disabled
+  unsigned long aging();
+
+  /**
+   * Set which idle thread a newly submitted task wakes. By default it is
+   * the one that has been idle the longest, which spreads a light load over
+   * every thread. <i>MostRecentlyIdle</i> keeps it on the few threads that
+   * were busy last, whose caches are still warm, and leaves the others
+   * parked; with a maxSize() those eventually exit.
+   */
+  void wakeOrder(WakeOrder order);
+
+  //! Get which idle thread a newly submitted task wakes
+  WakeOrder wakeOrder();
+
+  /**
+   * Set the number of tasks that may wait for a worker; tasks that are
+   * running do not count. The default, 0, lets any number wait.
+   */
+  void capacity(size_t n);
+
+  //! Get the number of tasks that may wait for a worker, 0 if unbounded
+  size_t capacity();
+
+  /**
+   * Set what becomes of a task submitted while the pool is at its
+   * capacity. The default is to Block indefinitely.
+   *
+   * @param policy saturation policy
+   * @param timeout time (milliseconds) a submitter may Block before the
+   *        task is turned away with a RejectedException, 0 to wait
+   *        indefinitely
+   */
+  void saturation(Saturation policy, unsigned long timeout = 0);
+
+  //! Get the saturation policy
+  Saturation saturation();
+
+  /**
+   * Get the CPU time consumed by the threads of this PoolExecutor, including
+   * worker threads that have since exited. Workers are named after their
+   * pool (e.g. <i>pool-3-w7</i>) so the time can also be attributed with
+   * system tools.
+   *
+   * @return unsigned long long CPU time in microseconds.
+   *
+   * @see Thread::getCpuTime()
+   */
+  unsigned long long getCpuTime();
+
+  /**
+   * Get a snapshot of the activity of this PoolExecutor: the tasks waiting,
+   * running, completed and failed, how long tasks waited and ran, and how
+   * busy each worker was. Each worker keeps its own counters, so tasks are
+   * recorded without contending with each other.
+   *
+   * @return ExecutorMetrics snapshot
+   */
+  ExecutorMetrics getMetrics();
+
   /**
    * Submit a task to this Executor.
    *
@@ -131,6 +331,61 @@ class PoolExecutor : public Executor {
    */
   virtual void Execute(const Task& task);
 
+  /**
+   * Submit a task with the given Priority. Tasks submitted without one, by
+   * Execute(const Task&) or ExecuteAll(), have a Medium priority. The
+   * priority only affects the order tasks start in a <i>Prioritized</i>
+   * pool; it does not change the priority of the thread running the task.
+   *
+   * @exception Cancellation_Exception thrown if the Executor was canceled prior
+   *            to the invocation of this function.
+   * @exception RejectedException thrown if the pool is at its capacity and
+   *            the task is turned away
+   */
+  void Execute(const Task& task, Priority p);
+
+  /**
+   * Submit a task bound to a CancellationToken. The task is skipped if the
+   * token is canceled before a worker gets to it, and the worker running it
+   * is interrupted if the token is canceled while it runs; other tasks are
+   * left alone.
+   *
+   * @exception Cancellation_Exception thrown if the Executor was canceled prior
+   *            to the invocation of this function.
+   * @exception RejectedException thrown if the pool is at its capacity and
+   *            the task is turned away
+   *
+   * @see CancellationToken
+   */
+  void Execute(const Task& task, CancellationToken token, Priority p = Medium);
+
+  /**
+   * Submit a task, unless the pool is at its capacity. The submitter never
+   * blocks or runs the task itself: under the Block and CallerRuns policies
+   * a task that does not fit is turned away, under DropOldest it makes
+   * room as Execute() would.
+   *
+   * @return bool false if the task was turned away
+   *
+   * @exception Cancellation_Exception thrown if the Executor was canceled prior
+   *            to the invocation of this function.
+   */
+  bool TryExecute(const Task& task, Priority p = Medium);
+
+  /**
+   * Submit a batch of tasks. The batch is queued under a single update of
+   * the pool's bookkeeping and wakes at most one idle worker per task; while
+   * the pool may grow, it starts the workers the batch needs at once. A
+   * pool with a capacity() admits each task of the batch as Execute() would.
+   *
+   * @exception Cancellation_Exception thrown if the Executor was canceled prior
+   *            to the invocation of this function. None of the tasks will be
+   *            run.
+   *
+   * @see Executor::ExecuteAll(const Task*, const Task*)
+   */
+  virtual void ExecuteAll(const Task* begin, const Task* end);
+
   /**
    * @see Cancelable::cancel()
    */
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTSCHEDULEDEXECUTOR_H__
+#define __ZTSCHEDULEDEXECUTOR_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/executor.h"
+
+namespace zthread {
+
+class ScheduledExecutorImpl;
+
+/**
+ * @class ScheduledTask
+ *
+ * Refers to a task scheduled with a ScheduledExecutor, and allows it to be
+ * canceled. Copies of a ScheduledTask refer to the same scheduled task.
+ *
+ * @see ScheduledExecutor
+ */
+class ScheduledTask {
+  friend class ScheduledExecutor;
+
+  //! Keeps the executor alive for as long as the task can be canceled
+  CountedPtr<ScheduledExecutorImpl> _owner;
+
+  CountedPtr<Runnable, AtomicCount> _event;
+
+  ScheduledTask(const CountedPtr<ScheduledExecutorImpl>& owner,
+                const CountedPtr<Runnable, AtomicCount>& event);
+
+ public:
+  //! Create a ScheduledTask that refers to no task
+  ScheduledTask();
+
+  ScheduledTask(const ScheduledTask&);
+
+  ~ScheduledTask();
+
+  ScheduledTask& operator=(const ScheduledTask&);
+
+  /**
+   * Cancel the task. This takes constant time, regardless of how many tasks
+   * are scheduled. A task that is already running is not interrupted.
+   *
+   * @return
+   *   - <em>true</em> if this prevented the task from running, or from
+   *     running again if it is periodic.
+   *   - <em>false</em> if the task had already run, or had been canceled.
+   */
+  bool Cancel();
+
+  //! Test whether the task was canceled before it completed
+  bool IsCanceled();
+
+  //! Test whether a one-shot task has run
+  bool IsDone();
+};
+
+/**
+ * @class ScheduledExecutor
+ *
+ * A ScheduledExecutor runs tasks after a delay, or periodically. It does
+ * not run the tasks itself; once a task is due, it is submitted to another
+ * Executor, typically a PoolExecutor.
+ *
+ * Scheduled tasks are kept in a hierarchical timing wheel with millisecond
+ * resolution, driven by a monotonic clock where the platform has one.
+ * Scheduling and canceling a task take constant time, so a large number of
+ * timeouts, most of which are canceled before they expire, is cheap to
+ * keep. A single thread advances the wheel and submits the tasks that are
+ * due, together, to the Executor.
+ *
+ * - <em>cancel</em>()ing a ScheduledExecutor cancels every task it has
+ *   scheduled and stops it from accepting new ones.
+ *
+ * - <em>interrupt</em>()ing a ScheduledExecutor interrupts the tasks it
+ *   has submitted that are running, or are waiting in the Executor to run.
+ *   Other tasks of that Executor are left alone.
+ *
+ * - <em>wait</em>()ing on a ScheduledExecutor blocks the calling thread
+ *   until every task that has been scheduled has run or been canceled; a
+ *   periodic task counts until it is canceled.
+ *
+ * @code
+ *
+ * PoolExecutor pool(4);
+ * ScheduledExecutor timer(pool);
+ *
+ * ScheduledTask timeout = timer.Schedule(new ExpireRequest(id), 30000);
+ * timer.ScheduleAtFixedRate(new ReportStats, 1000, 1000);
+ *
+ * // ... the request completed in time
+ * timeout.Cancel();
+ *
+ * @endcode
+ *
+ * @see Executor
+ */
+class ScheduledExecutor : public Executor {
+  CountedPtr<ScheduledExecutorImpl> _impl;
+
+  //! Cancellation task
+  Task _shutdown;
+
+ public:
+  /**
+   * Create a ScheduledExecutor.
+   *
+   * @param executor Executor that runs the tasks once they are due. It
+   *        must remain valid for as long as this ScheduledExecutor.
+   */
+  ScheduledExecutor(Executor& executor);
+
+  //! Destroy a ScheduledExecutor, canceling the tasks it has scheduled
+  virtual ~ScheduledExecutor();
+
+  /**
+   * Run a task once, after a delay.
+   *
+   * @param task Task to be run
+   * @param delay time (milliseconds) before the task is due
+   *
+   * @return ScheduledTask that can cancel the task
+   *
+   * @exception Cancellation_Exception thrown if this Executor has been
+   *            canceled.
+   */
+  ScheduledTask Schedule(const Task& task, unsigned long delay);
+
+  /**
+   * Run a task periodically. The task is first due after <i>delay</i>
+   * milliseconds, and then every <i>period</i> milliseconds after that first
+   * run was due. Runs never overlap; a run that starts late is followed by
+   * the runs that were missed, as soon as it completes.
+   *
+   * @exception Cancellation_Exception thrown if this Executor has been
+   *            canceled.
+   * @exception InvalidOp_Exception thrown if <i>period</i> is 0.
+   */
+  ScheduledTask ScheduleAtFixedRate(const Task& task, unsigned long delay,
+                                    unsigned long period);
+
+  /**
+   * Run a task periodically. The task is first due after <i>delay</i>
+   * milliseconds, and then <i>period</i> milliseconds after each run
+   * completes.
+   *
+   * @exception Cancellation_Exception thrown if this Executor has been
+   *            canceled.
+   * @exception InvalidOp_Exception thrown if <i>period</i> is 0.
+   */
+  ScheduledTask ScheduleWithFixedDelay(const Task& task, unsigned long delay,
+                                       unsigned long period);
+
+  /**
+   * Submit a task to be run as soon as possible.
+   *
+   * @see Executor::Execute(const Task&)
+   */
+  virtual void Execute(const Task& task);
+
+  /**
+   * Interrupt the scheduled tasks that are running, or that are due and
+   * waiting in the Executor to run. Tasks submitted to the Executor by
+   * anything else are not interrupted.
+   *
+   * @see Executor::Interrupt()
+   */
+  virtual void Interrupt();
+
+  //! Get the number of tasks that are scheduled and have not yet completed
+  size_t size();
+
+  /**
+   * @see Cancelable::cancel()
+   */
+  virtual void Cancel();
+
+  /**
+   * @see Cancelable::isCanceled()
+   */
+  virtual bool IsCanceled();
+
+  /**
+   * Block the calling thread until every task scheduled so far has run or
+   * has been canceled. A periodic task never finishes running on its own,
+   * so while one is scheduled this blocks until it is canceled.
+   *
+   * @exception Interrupted_Exception thrown if the calling thread is
+   *            interrupted first.
+   *
+   * @see Waitable::wait()
+   */
+  virtual void Wait();
+
+  /**
+   * @see ScheduledExecutor::Wait()
+   * @see Waitable::wait(unsigned long timeout)
+   */
+  virtual bool Wait(unsigned long timeout);
+};
+
+}  // namespace zthread
+
+#endif  // __ZTSCHEDULEDEXECUTOR_H__
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTSHARDEDEXECUTOR_H__
+#define __ZTSHARDEDEXECUTOR_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/executor.h"
+
+namespace zthread {
+
+class ShardedExecutorImpl;
+
+/**
+ * @class ShardedExecutor
+ *
+ * An Executor with one thread per shard, each pinned to its own processor
+ * where the system allows it, chosen among those the process may run on. A shard owns its run queue. Tasks another
+ * shard submits to it travel through a single producer, single consumer
+ * mailbox kept for that pair of shards, so shards never contend for a
+ * queue. Only threads outside the executor share a locked inbox per shard.
+ *
+ * This suits work that is already partitioned, such as requests hashed by
+ * connection: each partition stays on one processor, along with the data
+ * its tasks touch. Tasks submitted to the same shard by one thread run in
+ * the order they were submitted, one at a time. A shard kept busy does not
+ * lend its tasks to an idle one.
+ *
+ * @code
+ *
+ * ShardedExecutor shards;
+ *
+ * shards.SubmitTo(connection.id() % shards.size(), new ReadRequest(connection));
+ *
+ * @endcode
+ *
+ * @see Strand
+ */
+class ShardedExecutor : public Executor {
+  CountedPtr<ShardedExecutorImpl> _impl;
+
+  //! Cancellation task
+  Task _shutdown;
+
+ public:
+  /**
+   * Create a ShardedExecutor.
+   *
+   * @param shards number of shards, 0 for one per processor the process
+   *        may run on
+   * @param pin pin each shard's thread to a processor; false leaves the
+   *        threads to the system's scheduler, e.g. when the processors are
+   *        shared with other work
+   */
+  ShardedExecutor(size_t shards = 0, bool pin = true);
+
+  //! Destroy a ShardedExecutor; the tasks it has already accepted still run
+  virtual ~ShardedExecutor();
+
+  //! Get the number of shards
+  size_t size();
+
+  /**
+   * Get the shard the calling thread serves.
+   *
+   * @return size_t shard, or size() if the caller is not one of this
+   *         executor's threads
+   */
+  size_t current();
+
+  /**
+   * Submit a task to the given shard.
+   *
+   * @exception InvalidOp_Exception thrown if <i>shard</i> is not less than
+   *            size().
+   * @exception Cancellation_Exception thrown if this Executor has been
+   *            canceled.
+   */
+  void SubmitTo(size_t shard, const Task& task);
+
+  /**
+   * Submit a task to the shard running the caller. It goes straight onto
+   * that shard's run queue, without touching any other processor.
+   *
+   * @exception InvalidOp_Exception thrown if the caller is not one of this
+   *            executor's threads.
+   * @exception Cancellation_Exception thrown if this Executor has been
+   *            canceled.
+   */
+  void SubmitLocal(const Task& task);
+
+  /**
+   * Submit a task to the shard running the caller, or, from any other
+   * thread, to the shards in turn.
+   *
+   * @exception Cancellation_Exception thrown if this Executor has been
+   *            canceled.
+   */
+  virtual void Execute(const Task& task);
+
+  /**
+   * Interrupt the tasks running at the time this function is called, and
+   * those that were submitted before it and have yet to run.
+   */
+  virtual void Interrupt();
+
+  /**
+   * @see Cancelable::Cancel()
+   */
+  virtual void Cancel();
+
+  /**
+   * @see Cancelable::isCanceled()
+   */
+  virtual bool IsCanceled();
+
+  /**
+   * Wait for the tasks submitted before this call to complete.
+   *
+   * @exception Interrupted_Exception thrown if the thread is interrupted.
+   */
+  virtual void Wait();
+
+  /**
+   * Wait for the tasks submitted before this call to complete.
+   *
+   * @param timeout maximum amount of time (milliseconds) to wait
+   * @return bool false if the timeout expired first
+   *
+   * @exception Interrupted_Exception thrown if the thread is interrupted.
+   */
+  virtual bool Wait(unsigned long timeout);
+}; /* ShardedExecutor */
+
+}  // namespace zthread
+
+#endif  // __ZTSHARDEDEXECUTOR_H__
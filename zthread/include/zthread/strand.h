@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTSTRAND_H__
+#define __ZTSTRAND_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/executor.h"
+
+#include <vector>
+
+namespace zthread {
+
+class StrandImpl;
+
+/**
+ * @class Strand
+ *
+ * An Executor that runs its tasks one at a time, in the order they were
+ * submitted, on the threads of another Executor. Unlike a
+ * ConcurrentExecutor it owns no thread: while it has tasks, the Strand
+ * occupies one thread of the underlying Executor, and none otherwise, so
+ * any number of Strands can share a PoolExecutor.
+ *
+ * Consecutive tasks may run on different threads, but never at the same
+ * time, and each task sees the effects of those before it.
+ *
+ * A Strand with a long backlog gives its thread back to the underlying
+ * Executor after every few tasks, so other work queued there is not held
+ * up behind it.
+ *
+ * @see KeyedStrand
+ */
+class Strand : public Executor {
+  CountedPtr<StrandImpl> _impl;
+
+ public:
+  /**
+   * Create a Strand.
+   *
+   * @param executor Executor that runs the tasks. It must remain valid for
+   *        as long as this Strand has tasks.
+   */
+  Strand(Executor& executor);
+
+  //! Destroy a Strand; the tasks it has already accepted still run
+  virtual ~Strand();
+
+  /**
+   * Interrupt the task running at the time this function is called, and
+   * those that were submitted before it and have yet to run.
+   */
+  virtual void Interrupt();
+
+  /**
+   * Submit a task, to be run after those submitted before it.
+   *
+   * @exception Cancellation_Exception thrown if this Strand has been
+   *            canceled.
+   *
+   * If the Strand was idle and the underlying Executor refuses to run it,
+   * the exception the Executor throws is propagated and the task is not
+   * accepted. Tasks other threads submitted in the meantime are run on the
+   * calling thread before it returns.
+   */
+  virtual void Execute(const Task& task);
+
+  /**
+   * Submit a batch of tasks, to be run in order.
+   *
+   * @see Execute(const Task&)
+   */
+  virtual void ExecuteAll(const Task* begin, const Task* end);
+
+  //! Get the number of tasks waiting to run
+  size_t size();
+
+  /**
+   * @see Cancelable::Cancel()
+   */
+  virtual void Cancel();
+
+  /**
+   * @see Cancelable::isCanceled()
+   */
+  virtual bool IsCanceled();
+
+  /**
+   * Wait for the tasks submitted before this call to complete.
+   *
+   * @exception Interrupted_Exception thrown if the thread is interrupted.
+   */
+  virtual void Wait();
+
+  /**
+   * Wait for the tasks submitted before this call to complete.
+   *
+   * @param timeout maximum amount of time (milliseconds) to wait
+   * @return bool false if the timeout expired first
+   *
+   * @exception Interrupted_Exception thrown if the thread is interrupted.
+   */
+  virtual bool Wait(unsigned long timeout);
+}; /* Strand */
+
+/**
+ * @class KeyedStrand
+ *
+ * A fixed set of Strands sharing one Executor, each task being run on the
+ * Strand its key hashes to. Tasks with the same key run one at a time, in
+ * the order they were submitted; tasks with different keys may run
+ * concurrently, unless their keys share a Strand.
+ *
+ * This gives each entity, such as a connection, its own ordering without a
+ * Strand or a thread per entity.
+ *
+ * @code
+ *
+ * KeyedStrand strands(pool, 64);
+ *
+ * strands.Execute(connection.id(), new ReadRequest(connection));
+ *
+ * @endcode
+ */
+class KeyedStrand : public Cancelable, public Waitable, private NonCopyable {
+  std::vector<Strand*> _strands;
+
+ public:
+  /**
+   * Create a KeyedStrand.
+   *
+   * @param executor Executor that runs the tasks
+   * @param strands number of Strands the keys are spread over
+   *
+   * @exception InvalidOp_Exception thrown if <i>strands</i> is 0.
+   */
+  KeyedStrand(Executor& executor, size_t strands);
+
+  //! Destroy a KeyedStrand; the tasks it has already accepted still run
+  virtual ~KeyedStrand();
+
+  //! Get the Strand the given key hashes to
+  Strand& strand(unsigned long key);
+
+  /**
+   * Submit a task, to be run after those submitted before it with the same
+   * key.
+   *
+   * @see Strand::Execute(const Task&)
+   */
+  void Execute(unsigned long key, const Task& task);
+
+  //! Get the number of Strands
+  size_t size() const { return _strands.size(); }
+
+  //! Interrupt the tasks submitted before this call, with any key
+  void Interrupt();
+
+  /**
+   * @see Cancelable::Cancel()
+   */
+  virtual void Cancel();
+
+  /**
+   * @see Cancelable::isCanceled()
+   */
+  virtual bool IsCanceled();
+
+  //! Wait for the tasks submitted before this call, with any key
+  virtual void Wait();
+
+  /**
+   * Wait for the tasks submitted before this call, with any key.
+   *
+   * @param timeout maximum amount of time (milliseconds) to wait
+   * @return bool false if the timeout expired first
+   */
+  virtual bool Wait(unsigned long timeout);
+}; /* KeyedStrand */
+
+}  // namespace zthread
+
+#endif  // __ZTSTRAND_H__
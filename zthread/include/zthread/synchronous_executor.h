@@ -64,7 +64,7 @@ class SynchronousExecutor : public Executor {
   /**
    * This operation is not supported by this executor.
    */
-  virtual void interrupt();
+  virtual void Interrupt();
 
   /**
    * Submit a task to this Executor, blocking the calling thread until the
@@ -82,17 +82,17 @@ class SynchronousExecutor : public Executor {
    *
    * @see Executor::execute(const Task& task)
    */
-  virtual void execute(const Task& task);
+  virtual void Execute(const Task& task);
 
   /**
    * @see Cancelable::cancel()
    */
-  virtual void cancel();
+  virtual void Cancel();
 
   /**
    * @see Cancelable::cancel()
    */
-  virtual bool isCanceled();
+  virtual bool IsCanceled();
 
   /**
    * Block the calling thread until all tasks submitted prior to this invocation
@@ -104,7 +104,7 @@ class SynchronousExecutor : public Executor {
    *
    * @see Executor::wait()
    */
-  virtual void wait();
+  virtual void Wait();
 
   /**
    * Block the calling thread until all tasks submitted prior to this invocation
@@ -122,7 +122,7 @@ class SynchronousExecutor : public Executor {
    *                   <i>timeout</i> milliseconds elapse.
    *   - <em>false</em> othewise.
    */
-  virtual bool wait(unsigned long timeout);
+  virtual bool Wait(unsigned long timeout);
 
 }; /* SynchronousExecutor */
 
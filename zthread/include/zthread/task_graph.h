@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTTASKGRAPH_H__
+#define __ZTTASKGRAPH_H__
+
+#include "zthread/counted_ptr.h"
+#include "zthread/executor.h"
+#include "zthread/waitable.h"
+
+namespace zthread {
+
+class TaskGraphImpl;
+
+/**
+ * @class TaskGraph
+ *
+ * A set of tasks with dependencies between them, run on an Executor. A
+ * task is submitted as soon as every task it depends on has completed,
+ * rather than at the end of a phase, so the executor's threads are kept
+ * busy for as long as any task is ready to run.
+ *
+ * Each task keeps a count of the tasks it still waits for, which the task
+ * completing last brings to zero; that task submits it. No lock is taken
+ * while the graph runs, except to wake the threads waiting for it.
+ *
+ * A graph can be run any number of times. Nothing is allocated by a run
+ * once the graph has been run the first time after its last change,
+ * apart from what the executor allocates to queue the tasks.
+ *
+ * If a task throws an exception, the tasks that depend on it, directly or
+ * not, are skipped; the others still run.
+ *
+ * @code
+ *
+ * TaskGraph graph(pool);
+ *
+ * TaskGraph::Node parse = graph.add(new Parse);
+ * TaskGraph::Node check = graph.add(new Check);
+ * TaskGraph::Node emit = graph.add(new Emit);
+ *
+ * graph.precede(parse, check);
+ * graph.precede(parse, emit);
+ *
+ * graph.Run();
+ * graph.Wait();
+ *
+ * @endcode
+ */
+class TaskGraph : public Waitable, private NonCopyable {
+  CountedPtr<TaskGraphImpl> _impl;
+
+ public:
+  //! Identifies a task in the graph
+  typedef size_t Node;
+
+  /**
+   * Create an empty TaskGraph.
+   *
+   * @param executor Executor that runs the tasks. It must remain valid for
+   *        as long as this TaskGraph.
+   */
+  TaskGraph(Executor& executor);
+
+  //! Destroy a TaskGraph, waiting for a run in progress to complete
+  virtual ~TaskGraph();
+
+  /**
+   * Add a task to the graph.
+   *
+   * @param task Task to be run
+   * @return Node identifying the task
+   *
+   * @exception InvalidOp_Exception thrown if the graph is running.
+   */
+  Node add(const Task& task);
+
+  /**
+   * Make a task wait for another to complete before it runs.
+   *
+   * @param before task to be run first
+   * @param after task to be run once <i>before</i> has completed
+   *
+   * @exception InvalidOp_Exception thrown if the graph is running, or if
+   *            either node is not part of the graph or both are the same.
+   */
+  void precede(Node before, Node after);
+
+  //! Get the number of tasks in the graph
+  size_t size();
+
+  /**
+   * Get the number of tasks that threw an exception, or were skipped
+   * because a task they depend on did, during the last run.
+   */
+  size_t failed();
+
+  /**
+   * Run the graph, submitting the tasks that depend on no other task. The
+   * call returns without waiting for the graph to complete.
+   *
+   * A task that the executor will not accept is treated as having failed.
+   *
+   * @exception InvalidOp_Exception thrown if the graph is already running,
+   *            or if its dependencies form a cycle.
+   */
+  void Run();
+
+  /**
+   * Wait for the current run of the graph to complete. Returns at once if
+   * the graph is not running.
+   *
+   * @exception Interrupted_Exception thrown if the thread is interrupted.
+   */
+  virtual void Wait();
+
+  /**
+   * Wait for the current run of the graph to complete.
+   *
+   * @param timeout maximum amount of time (milliseconds) to wait
+   * @return bool false if the timeout expired first
+   *
+   * @exception Interrupted_Exception thrown if the thread is interrupted.
+   */
+  virtual bool Wait(unsigned long timeout);
+};
+
+}  // namespace zthread
+
+#endif  // __ZTTASKGRAPH_H__
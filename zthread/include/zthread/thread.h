@@ -282,6 +282,30 @@ class ZTHREAD_API Thread : public Cancelable,
    */
   Priority getPriority();
 
+  /**
+   * Name this Thread. The name is given to the native thread, where the
+   * system supports it, so that it appears in tools like top, perf and gdb.
+   * Names longer than the system allows are truncated (15 characters on
+   * Linux).
+   *
+   * @param name new name for the thread
+   *
+   * @return
+   *   - <em>true</em> if the native thread was named.
+   *   - <em>false</em> if the thread is not running or naming threads is not
+   *     supported.
+   */
+  bool setName(const char* name);
+
+  /**
+   * Get the CPU time consumed by this Thread's task so far. Once the task
+   * completes, the total CPU time it consumed is reported.
+   *
+   * @return unsigned long long CPU time in microseconds, or 0 if the system
+   *         does not support per-thread CPU clocks.
+   */
+  unsigned long long getCpuTime();
+
   /**
    * Interrupts this thread, setting the <i>interrupted</i> status of the
    * thread.
@@ -380,6 +404,27 @@ class ZTHREAD_API Thread : public Cancelable,
    */
   static void yield();
 
+  /**
+   * Enable reuse of native threads. Once a thread completes its task it is
+   * parked for up to <i>timeout</i> milliseconds, and the next Thread
+   * constructed in that time runs its task on the parked thread instead of
+   * spawning a new one. Joining, interrupting, canceling and ThreadLocal
+   * values behave exactly as they would for a newly spawned thread.
+   *
+   * Reuse is disabled by default.
+   *
+   * @param timeout maximum amount of time (milliseconds) a thread is kept
+   *        parked, or 0 to disable reuse and release any parked threads.
+   */
+  static void setCacheTimeout(unsigned long timeout);
+
+  /**
+   * Get the amount of time threads are kept parked for reuse.
+   *
+   * @return unsigned long timeout in milliseconds, 0 if reuse is disabled.
+   */
+  static unsigned long getCacheTimeout();
+
 }; /* Thread */
 
 }  // namespace ZThread
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTTHREADGROUP_H__
+#define __ZTTHREADGROUP_H__
+
+#include "zthread/cancelable.h"
+#include "zthread/counted_ptr.h"
+#include "zthread/non_copyable.h"
+#include "zthread/task.h"
+#include "zthread/waitable.h"
+
+namespace zthread {
+
+class ThreadGroupImpl;
+
+/**
+ * @class ThreadGroup
+ *
+ * A ThreadGroup spawns a set of threads and manages them together. Rather
+ * than join()ing each thread in turn, a single wait() covers every thread in
+ * the group; the threads report to a shared completion count as they finish.
+ *
+ * - <em>wait</em>()ing on a ThreadGroup blocks the calling thread until every
+ *   thread spawned by the group has completed its task.
+ *
+ * - <em>WaitAny</em>() blocks the calling thread until some thread in the
+ *   group completes. Each completion is reported to one WaitAny() call.
+ *
+ * - <em>interrupt</em>()ing a ThreadGroup interrupts every running thread in
+ *   the group.
+ *
+ * - <em>cancel</em>()ing a ThreadGroup cancels every running thread in the
+ *   group, and the group stops accepting new tasks.
+ *
+ * Threads continue to run their tasks if the ThreadGroup goes out of scope.
+ *
+ * @code
+ *
+ * ThreadGroup group;
+ *
+ * for(size_t n = 0; n < 64; n++)
+ *   group.Spawn(new aRunnable);
+ *
+ * group.Wait();
+ *
+ * @endcode
+ */
+class ZTHREAD_API ThreadGroup : public Cancelable,
+                                public Waitable,
+                                private NonCopyable {
+  //! Reference to the internal implementation
+  CountedPtr<ThreadGroupImpl> _impl;
+
+ public:
+  //! Create an empty ThreadGroup
+  ThreadGroup();
+
+  //! Destroy a ThreadGroup
+  virtual ~ThreadGroup();
+
+  /**
+   * Spawn a new thread in this group to run the given task.
+   *
+   * @param task Task to be run by the new thread
+   *
+   * @exception Cancellation_Exception thrown if this ThreadGroup has been
+   *            canceled.
+   * @exception Synchronization_Exception thrown if the thread could not be
+   *            started.
+   */
+  void Spawn(const Task& task);
+
+  /**
+   * Get the number of threads in this group that are still running.
+   *
+   * @return size_t number of running threads
+   */
+  size_t Size();
+
+  /**
+   * Interrupt every thread in this group that is still running.
+   *
+   * @see Thread::interrupt()
+   */
+  void interrupt();
+
+  /**
+   * Cancel every thread in this group that is still running. No further
+   * tasks are accepted by this group.
+   *
+   * @see Thread::Cancel()
+   * @see Cancelable::cancel()
+   */
+  virtual void Cancel();
+
+  /**
+   * @see Cancelable::isCanceled()
+   */
+  virtual bool IsCanceled();
+
+  /**
+   * Block the calling thread until every thread spawned by this group has
+   * completed.
+   *
+   * @exception Interrupted_Exception thrown if the calling thread is
+   *            interrupted before the threads complete.
+   *
+   * @see Waitable::wait()
+   */
+  virtual void Wait();
+
+  /**
+   * Block the calling thread until every thread spawned by this group has
+   * completed, or until the timeout expires.
+   *
+   * @param timeout maximum amount of time (milliseconds) to wait.
+   *
+   * @return
+   *   - <em>true</em> if the threads completed before <i>timeout</i>
+   *     milliseconds elapse.
+   *   - <em>false</em> otherwise.
+   *
+   * @exception Interrupted_Exception thrown if the calling thread is
+   *            interrupted before the threads complete.
+   *
+   * @see Waitable::wait(unsigned long timeout)
+   */
+  virtual bool Wait(unsigned long timeout);
+
+  /**
+   * Block the calling thread until a thread in this group completes. Each
+   * completion satisfies only one call, so calling WaitAny() once for each
+   * thread spawned visits every completion. Returns immediately when no
+   * completion is left to report and no thread is running.
+   *
+   * @exception Interrupted_Exception thrown if the calling thread is
+   *            interrupted before a thread completes.
+   */
+  void WaitAny();
+
+  /**
+   * Block the calling thread until a thread in this group completes, or
+   * until the timeout expires.
+   *
+   * @param timeout maximum amount of time (milliseconds) to wait.
+   *
+   * @return
+   *   - <em>true</em> if a completion was reported before <i>timeout</i>
+   *     milliseconds elapse, or if there was nothing left to wait for.
+   *   - <em>false</em> otherwise.
+   *
+   * @exception Interrupted_Exception thrown if the calling thread is
+   *            interrupted before a thread completes.
+   */
+  bool WaitAny(unsigned long timeout);
+
+}; /* ThreadGroup */
+
+}  // namespace zthread
+
+#endif  // __ZTTHREADGROUP_H__
@@ -27,12 +27,14 @@
 #ifndef __ZTTHREADEDEXECUTOR_H__
 #define __ZTTHREADEDEXECUTOR_H__
 
+#include "zthread/cancellation_token.h"
 #include "zthread/counted_ptr.h"
 #include "zthread/executor.h"
+#include "zthread/executor_metrics.h"
 
 namespace zthread {
 
-class ExecutorImpl;
+class ThreadedExecutorImpl;
 
 /**
  * @class ThreadedExecutor
@@ -60,7 +62,7 @@ class ExecutorImpl;
  * @see Executor.
  */
 class ThreadedExecutor : public Executor {
-  CountedPtr<ExecutorImpl> _impl;
+  CountedPtr<ThreadedExecutorImpl> _impl;
 
  public:
   //! Create a new ThreadedExecutor
@@ -75,7 +77,7 @@ class ThreadedExecutor : public Executor {
    * called. Tasks that are submitted after this function is called will
    * not be interrupt()ed; unless this function is invoked again().
    */
-  virtual void interrupt();
+  virtual void Interrupt();
 
   /**
    * Submit a task to this Executor. This will not block the current thread
@@ -88,17 +90,64 @@ class ThreadedExecutor : public Executor {
    *
    * @see Executor::execute(const Task&)
    */
-  virtual void execute(const Task&);
+  virtual void Execute(const Task&);
+
+  /**
+   * Submit a task bound to a CancellationToken. The task is skipped if the
+   * token is canceled before its thread starts it, and its thread is
+   * interrupted if the token is canceled while it runs; Interrupt() on the
+   * other hand interrupts every task.
+   *
+   * @exception Cancellation_Exception thrown if this Executor has been
+   * canceled.
+   *
+   * @see CancellationToken
+   */
+  void Execute(const Task& task, CancellationToken token);
+
+  /**
+   * Submit a batch of tasks to this Executor, starting a new thread for each
+   * of them. The batch is counted by Wait() as a single update.
+   *
+   * @exception Cancellation_Exception thrown if this Executor has been
+   * canceled. None of the Tasks will be executed by this Executor.
+   *
+   * @see Executor::ExecuteAll(const Task*, const Task*)
+   */
+  virtual void ExecuteAll(const Task* begin, const Task* end);
+
+  /**
+   * Get the CPU time consumed by the threads this ThreadedExecutor has
+   * started, including those that have since exited. Each thread is named
+   * after the executor (e.g. <i>threaded-2-t5</i>) so the time can also be
+   * attributed with system tools.
+   *
+   * @return unsigned long long CPU time in microseconds.
+   *
+   * @see Thread::getCpuTime()
+   */
+  unsigned long long getCpuTime();
+
+  /**
+   * Get a snapshot of the activity of this ThreadedExecutor. A task is
+   * queued until the thread started for it begins to run; the snapshot
+   * lists no workers, each thread runs a single task.
+   *
+   * @return ExecutorMetrics snapshot
+   *
+   * @see PoolExecutor::getMetrics()
+   */
+  ExecutorMetrics getMetrics();
 
   /**
    * @see Cancelable::cancel()
    */
-  virtual void cancel();
+  virtual void Cancel();
 
   /**
    * @see Cancelable::isCanceled()
    */
-  virtual bool isCanceled();
+  virtual bool IsCanceled();
 
   /**
    * Waiting on a ThreadedExecutor will block the current thread until all
@@ -115,7 +164,7 @@ class ThreadedExecutor : public Executor {
    *
    * @see Waitable::wait()
    */
-  virtual void wait();
+  virtual void Wait();
 
   /**
    * Operates the same as ThreadedExecutor::wait() but with a timeout.
@@ -135,7 +184,7 @@ class ThreadedExecutor : public Executor {
    *
    * @see Waitable::wait(unsigned long timeout)
    */
-  virtual bool wait(unsigned long timeout);
+  virtual bool Wait(unsigned long timeout);
 
 }; /* ThreadedExecutor */
 
@@ -32,6 +32,7 @@
 #include "zthread/blocking_queue.h"
 #include "zthread/bounded_queue.h"
 #include "zthread/cancelable.h"
+#include "zthread/cancellation_token.h"
 #include "zthread/class_lockable.h"
 #include "zthread/concurrent_executor.h"
 #include "zthread/condition.h"
@@ -43,12 +44,14 @@
 #include "zthread/fair_read_write_lock.h"
 #include "zthread/fast_mutex.h"
 #include "zthread/fast_recursive_mutex.h"
+#include "zthread/future.h"
 #include "zthread/guard.h"
 #include "zthread/lockable.h"
 #include "zthread/locked_queue.h"
 #include "zthread/monitored_queue.h"
 #include "zthread/mutex.h"
 #include "zthread/non_copyable.h"
+#include "zthread/parallel.h"
 #include "zthread/pool_executor.h"
 #include "zthread/priority.h"
 #include "zthread/priority_condition.h"
@@ -59,12 +62,21 @@
 #include "zthread/read_write_lock.h"
 #include "zthread/recursive_mutex.h"
 #include "zthread/runnable.h"
+#include "zthread/scheduled_executor.h"
 #include "zthread/semaphore.h"
+#include "zthread/sharded_executor.h"
 #include "zthread/singleton.h"
+#include "zthread/strand.h"
 #include "zthread/synchronous_executor.h"
+#include "zthread/task_graph.h"
 #include "zthread/thread.h"
+#include "zthread/thread_group.h"
 #include "zthread/thread_local.h"
 #include "zthread/time.h"
 #include "zthread/waitable.h"
 
+#if defined(ZTHREAD_COROUTINES)
+#include "zthread/coroutine.h"
+#endif
+
 #endif
@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTATOMICOPS_H__
+#define __ZTATOMICOPS_H__
+
+#include "fast_lock.h"
+#include "zthread/guard.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <windows.h>
+#endif
+
+namespace zthread {
+
+/**
+ * @namespace atomic
+ *
+ * Word sized atomic operations for the lock-free structures used inside the
+ * library. Loads acquire, stores release, and read-modify-write operations
+ * and fence() are sequentially consistent.
+ *
+ * GCC compatible compilers use their __atomic builtins, and Visual C++ its
+ * Interlocked intrinsics. Elsewhere every operation is serialized by a
+ * single FastLock, which is correct but only meant as a last resort.
+ */
+namespace atomic {
+
+#if defined(__GNUC__)
+
+template <typename T>
+inline T load(const volatile T* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+template <typename T>
+inline void store(volatile T* p, T value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+//! Replace the value if it is still <i>expected</i>; true if replaced
+template <typename T>
+inline bool cas(volatile T* p, T expected, T desired) {
+  return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+//! Add to the value, returning the result
+template <typename T>
+inline T add(volatile T* p, T n) {
+  return __atomic_add_fetch(p, n, __ATOMIC_SEQ_CST);
+}
+
+//! Replace the value, returning the previous value
+template <typename T>
+inline T exchange(volatile T* p, T value) {
+  return __atomic_exchange_n(p, value, __ATOMIC_SEQ_CST);
+}
+
+inline void fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+//! Hint to the processor that the caller is spinning on a value
+inline void pause() {
+#if defined(__i386__) || defined(__x86_64__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+#elif defined(_MSC_VER)
+
+//! Keep the compiler, and weaker processors, from moving accesses across
+inline void barrier() {
+#if defined(_M_IX86) || defined(_M_X64)
+  _ReadWriteBarrier();
+#else
+  MemoryBarrier();
+#endif
+}
+
+/**
+ * The Interlocked intrinsics for one operand size, on the integer of that
+ * size. cas() returns the value it found.
+ */
+template <size_t N>
+struct Interlocked;
+
+template <>
+struct Interlocked<1> {
+  typedef char Word;
+
+  static Word cas(volatile Word* p, Word expected, Word desired) {
+    return _InterlockedCompareExchange8(p, desired, expected);
+  }
+
+  static Word exchange(volatile Word* p, Word value) {
+    return _InterlockedExchange8(p, value);
+  }
+
+  static Word add(volatile Word* p, Word n) {
+    return _InterlockedExchangeAdd8(p, n) + n;
+  }
+};
+
+template <>
+struct Interlocked<2> {
+  typedef short Word;
+
+  static Word cas(volatile Word* p, Word expected, Word desired) {
+    return _InterlockedCompareExchange16(p, desired, expected);
+  }
+
+  static Word exchange(volatile Word* p, Word value) {
+    return _InterlockedExchange16(p, value);
+  }
+
+  static Word add(volatile Word* p, Word n) {
+    return _InterlockedExchangeAdd16(p, n) + n;
+  }
+};
+
+template <>
+struct Interlocked<4> {
+  typedef long Word;
+
+  static Word cas(volatile Word* p, Word expected, Word desired) {
+    return _InterlockedCompareExchange(p, desired, expected);
+  }
+
+  static Word exchange(volatile Word* p, Word value) {
+    return _InterlockedExchange(p, value);
+  }
+
+  static Word add(volatile Word* p, Word n) {
+    return _InterlockedExchangeAdd(p, n) + n;
+  }
+};
+
+template <>
+struct Interlocked<8> {
+  typedef __int64 Word;
+
+  static Word cas(volatile Word* p, Word expected, Word desired) {
+    return _InterlockedCompareExchange64(p, desired, expected);
+  }
+
+#if defined(_WIN64)
+
+  static Word exchange(volatile Word* p, Word value) {
+    return _InterlockedExchange64(p, value);
+  }
+
+  static Word add(volatile Word* p, Word n) {
+    return _InterlockedExchangeAdd64(p, n) + n;
+  }
+
+#else
+
+  // A 32 bit processor only swaps 64 bits by comparing them
+  static Word exchange(volatile Word* p, Word value) {
+    Word old = *p, seen;
+    while ((seen = cas(p, old, value)) != old) old = seen;
+
+    return old;
+  }
+
+  static Word add(volatile Word* p, Word n) {
+    Word old = *p, seen;
+    while ((seen = cas(p, old, old + n)) != old) old = seen;
+
+    return old + n;
+  }
+
+#endif
+};
+
+//! A value seen as the integer of its size
+template <typename T>
+union Bits {
+  typedef typename Interlocked<sizeof(T)>::Word Word;
+
+  T value;
+  Word word;
+
+  Bits(T v) { value = v; }
+  Bits(Word w, int) { word = w; }
+};
+
+template <typename T>
+inline typename Bits<T>::Word volatile* word(const volatile T* p) {
+  return reinterpret_cast<typename Bits<T>::Word volatile*>(
+      const_cast<T*>(p));
+}
+
+template <typename T>
+inline T load(const volatile T* p) {
+#if !defined(_WIN64)
+  // A plain load of 64 bits may tear on a 32 bit processor
+  if (sizeof(T) == 8)
+    return Bits<T>(Interlocked<sizeof(T)>::cas(word(p), 0, 0), 0).value;
+#endif
+
+  T value = *p;
+  barrier();
+
+  return value;
+}
+
+template <typename T>
+inline void store(volatile T* p, T value) {
+#if !defined(_WIN64)
+  if (sizeof(T) == 8) {
+    Interlocked<sizeof(T)>::exchange(word(p), Bits<T>(value).word);
+    return;
+  }
+#endif
+
+  barrier();
+  *p = value;
+}
+
+//! Replace the value if it is still <i>expected</i>; true if replaced
+template <typename T>
+inline bool cas(volatile T* p, T expected, T desired) {
+  Bits<T> e(expected);
+
+  return Interlocked<sizeof(T)>::cas(word(p), e.word, Bits<T>(desired).word) ==
+         e.word;
+}
+
+//! Add to the value, returning the result
+template <typename T>
+inline T add(volatile T* p, T n) {
+  return Bits<T>(Interlocked<sizeof(T)>::add(word(p), Bits<T>(n).word), 0)
+      .value;
+}
+
+//! Replace the value, returning the previous value
+template <typename T>
+inline T exchange(volatile T* p, T value) {
+  return Bits<T>(Interlocked<sizeof(T)>::exchange(word(p),
+                                                  Bits<T>(value).word),
+                 0).value;
+}
+
+inline void fence() { MemoryBarrier(); }
+
+//! Hint to the processor that the caller is spinning on a value
+inline void pause() { YieldProcessor(); }
+
+#else
+
+inline FastLock& lock() {
+  static FastLock l;
+  return l;
+}
+
+template <typename T>
+inline T load(const volatile T* p) {
+  Guard<FastLock> g(lock());
+  return *p;
+}
+
+template <typename T>
+inline void store(volatile T* p, T value) {
+  Guard<FastLock> g(lock());
+  *p = value;
+}
+
+template <typename T>
+inline bool cas(volatile T* p, T expected, T desired) {
+  Guard<FastLock> g(lock());
+
+  if (*p != expected) return false;
+
+  *p = desired;
+  return true;
+}
+
+template <typename T>
+inline T add(volatile T* p, T n) {
+  Guard<FastLock> g(lock());
+  return *p += n;
+}
+
+template <typename T>
+inline T exchange(volatile T* p, T value) {
+  Guard<FastLock> g(lock());
+
+  T old = *p;
+  *p = value;
+
+  return old;
+}
+
+inline void fence() { Guard<FastLock> g(lock()); }
+
+inline void pause() {}
+
+#endif
+
+}  // namespace atomic
+
+}  // namespace zthread
+
+#endif  // __ZTATOMICOPS_H__
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/cancellation_token.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+
+#include "atomic_ops.h"
+#include "thread_impl.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace zthread {
+
+/**
+ * @class CancellationState
+ *
+ * A node in a tree of tokens. A state keeps its parent alive, while the
+ * parent only links to its children, which unlink themselves when they are
+ * destroyed; cancel() walks the children while holding the parent's lock,
+ * which an unlinking child has to acquire first.
+ */
+class CancellationState : private NonCopyable {
+  volatile bool _canceled;
+
+  CountedPtr<CancellationState> _parent;
+
+  //! Children, linked through their siblings
+  CancellationState* _child;
+  CancellationState* _prev;
+  CancellationState* _next;
+
+  //! Threads running tasks bound to this token
+  std::vector<ThreadImpl*> _threads;
+
+  FastMutex _lock;
+
+ public:
+  CancellationState() : _canceled(false), _child(0), _prev(0), _next(0) {}
+
+  CancellationState(const CountedPtr<CancellationState>& parent,
+                    CancellationState* p)
+      : _canceled(false), _parent(parent), _child(0), _prev(0), _next(0) {
+    Guard<FastMutex> g(p->_lock);
+
+    _canceled = p->_canceled;
+
+    if ((_next = p->_child) != 0) _next->_prev = this;
+    p->_child = this;
+  }
+
+  ~CancellationState() {
+    if (!_parent) return;
+
+    CancellationState* p = &*_parent;
+    Guard<FastMutex> g(p->_lock);
+
+    if (_prev)
+      _prev->_next = _next;
+    else
+      p->_child = _next;
+
+    if (_next) _next->_prev = _prev;
+  }
+
+  bool isCanceled() { return atomic::load(&_canceled); }
+
+  volatile bool* flag() { return &_canceled; }
+
+  void cancel() {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) return;
+    atomic::store(&_canceled, true);
+
+    for (size_t i = 0; i < _threads.size(); ++i) _threads[i]->interrupt();
+
+    for (CancellationState* c = _child; c != 0; c = c->_next) c->cancel();
+  }
+
+  /**
+   * Register the current thread as running a task bound to this token.
+   *
+   * @return bool false if the token was canceled, and the task should be
+   *         skipped
+   */
+  bool enter(ThreadImpl* impl) {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) return false;
+
+    _threads.push_back(impl);
+    return true;
+  }
+
+  void leave(ThreadImpl* impl) {
+    Guard<FastMutex> g(_lock);
+
+    _threads.erase(std::find(_threads.begin(), _threads.end(), impl));
+  }
+
+}; /* CancellationState */
+
+namespace {
+
+//! Runs a task on behalf of a token
+class BoundTask : public Runnable {
+  Task _task;
+  CountedPtr<CancellationState> _state;
+
+ public:
+  BoundTask(const Task& task, const CountedPtr<CancellationState>& state)
+      : _task(task), _state(state) {}
+
+  void run() {
+    // Skip the task without taking the lock if the token is canceled
+    if (_state->isCanceled()) return;
+
+    ThreadImpl* impl = ThreadImpl::current();
+    if (!_state->enter(impl)) return;
+
+    try {
+      _task->run();
+    } catch (...) {
+      leave(impl);
+      throw;
+    }
+
+    leave(impl);
+  }
+
+  //! Unregister the thread, clearing an interruption left by cancel() so it
+  //! does not reach the next task the thread runs
+  void leave(ThreadImpl* impl) {
+    _state->leave(impl);
+
+    // Once the thread has left, cancel() can no longer interrupt it
+    if (_state->isCanceled()) impl->isInterrupted();
+  }
+};
+}
+
+CancellationToken::CancellationToken(CancellationState* state)
+    : _state(state), _canceled(state->flag()) {}
+
+CancellationToken::CancellationToken()
+    : _state(new CancellationState), _canceled(_state->flag()) {}
+
+CancellationToken::CancellationToken(const CancellationToken& token)
+    : _state(token._state), _canceled(token._canceled) {}
+
+CancellationToken::~CancellationToken() {}
+
+CancellationToken& CancellationToken::operator=(
+    const CancellationToken& token) {
+  _state = token._state;
+  _canceled = token._canceled;
+
+  return *this;
+}
+
+CancellationToken CancellationToken::child() {
+  return CancellationToken(new CancellationState(_state, &*_state));
+}
+
+void CancellationToken::cancel() { _state->cancel(); }
+
+bool CancellationToken::isCanceled() const { return atomic::load(_canceled); }
+
+Task CancellationToken::bind(const Task& task) {
+  return Task(new BoundTask(task, _state));
+}
+
+}  // namespace zthread
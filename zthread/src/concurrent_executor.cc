@@ -34,10 +34,22 @@ void ConcurrentExecutor::Interrupt() { executor_.Interrupt(); }
 
 void ConcurrentExecutor::Execute(const Task& task) { executor_.Execute(task); }
 
+void ConcurrentExecutor::ExecuteAll(const Task* begin, const Task* end) {
+  executor_.ExecuteAll(begin, end);
+}
+
 void ConcurrentExecutor::Cancel() { executor_.Cancel(); }
 
 bool ConcurrentExecutor::IsCanceled() { return executor_.IsCanceled(); }
 
+unsigned long long ConcurrentExecutor::getCpuTime() {
+  return executor_.getCpuTime();
+}
+
+ExecutorMetrics ConcurrentExecutor::getMetrics() {
+  return executor_.getMetrics();
+}
+
 void ConcurrentExecutor::Wait() { executor_.Wait(); }
 
 bool ConcurrentExecutor::Wait(unsigned long timeout) {
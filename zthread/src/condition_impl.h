@@ -28,6 +28,7 @@
 #define __ZTCONDITIONIMPL_H__
 
 #include "zthread/guard.h"
+#include "zthread/lockable.h"
 
 #include "debug.h"
 #include "deferred_interruption_scope.h"
@@ -59,10 +60,15 @@ class ConditionImpl {
   /**
    * Create a new ConditionImpl.
    *
+   * @param predicateLock external lock
+   * @param waiters empty waiter list to start from, for lists that are
+   *        configured when they are created
+   *
    * @exception Initialization_Exception thrown if resources could not be
    * allocated
    */
-  ConditionImpl(Lockable& predicateLock) : _predicateLock(predicateLock) {}
+  ConditionImpl(Lockable& predicateLock, const List& waiters = List())
+      : _waiters(waiters), _predicateLock(predicateLock) {}
 
   /**
    * Destroy this ConditionImpl, release its resources
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#if defined(ZTHREAD_COROUTINES)
+
+#include "zthread/coroutine.h"
+
+namespace zthread {
+
+namespace coro {
+
+namespace {
+
+//! Resumes a suspended coroutine from a thread of an Executor
+class Resumer : public Runnable {
+  std::coroutine_handle<> _handle;
+
+ public:
+  Resumer(std::coroutine_handle<> h) : _handle(h) {}
+
+  void run() { _handle.resume(); }
+};
+}
+
+void post(Executor& executor, std::coroutine_handle<> handle) {
+  executor.Execute(zthread::Task(new Resumer(handle)));
+}
+
+void resume(Executor& executor, std::coroutine_handle<> handle) noexcept {
+  try {
+    post(executor, handle);
+    return;
+  } catch (...) {
+  }
+
+  handle.resume();
+}
+
+Mutex::Mutex(Executor& executor) : _locked(false), _executor(executor) {}
+
+Mutex::~Mutex() {}
+
+bool Mutex::TryAcquire() {
+  Guard<FastMutex> g(_lock);
+
+  if (_locked) return false;
+
+  _locked = true;
+  return true;
+}
+
+bool Mutex::wait(Waiter* w) {
+  Guard<FastMutex> g(_lock);
+
+  if (!_locked) {
+    _locked = true;
+    return false;
+  }
+
+  _waiters.push(w);
+  return true;
+}
+
+void Mutex::Release() {
+  Waiter* w;
+
+  {
+    Guard<FastMutex> g(_lock);
+
+    // The Mutex stays locked, on behalf of the first waiter
+    if ((w = _waiters.pop()) == 0) _locked = false;
+  }
+
+  if (w) resume(_executor, w->handle);
+}
+
+}  // namespace coro
+
+}  // namespace zthread
+
+#endif  // ZTHREAD_COROUTINES
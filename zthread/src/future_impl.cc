@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/future_impl.h"
+#include "zthread/exceptions.h"
+
+#include "atomic_ops.h"
+#include "thread_impl.h"
+
+namespace zthread {
+
+namespace {
+
+typedef enum { PENDING, SETTING, DONE, FAILED } FutureState;
+
+//! Marks the listener list of a completed future
+char closedTag;
+FutureImpl::Listener* const CLOSED =
+    reinterpret_cast<FutureImpl::Listener*>(&closedTag);
+
+/**
+ * @class Waiter
+ *
+ * A thread blocked on a future. A Waiter that gives up before the future
+ * completes is abandoned in the listener list, and deleted by whichever of
+ * the next push(), the completion or the future's destruction comes first.
+ * Otherwise the waiting thread deletes it once the completing thread is
+ * done with it.
+ */
+class Waiter : public FutureImpl::Listener {
+ public:
+  typedef enum { WAITING, NOTIFIED, ABANDONED } WaiterState;
+
+  ThreadImpl* impl;
+  volatile long state;
+  volatile bool woken;
+  volatile bool signaled;
+
+  Waiter(ThreadImpl* t)
+      : impl(t), state(WAITING), woken(false), signaled(false) {}
+
+  void complete() {
+    if (!atomic::cas(&state, (long)WAITING, (long)NOTIFIED)) {
+      delete this;
+      return;
+    }
+
+    Monitor& m = impl->getMonitor();
+
+    m.Acquire();
+
+    signaled = m.notify();
+    woken = true;
+
+    m.Release();
+  }
+
+  //! Give up waiting; false if the completing thread got here first
+  bool abandon() {
+    return atomic::cas(&state, (long)WAITING, (long)ABANDONED);
+  }
+
+  bool abandoned() { return atomic::load(&state) == (long)ABANDONED; }
+};
+
+//! Submits a task to an Executor as the future completes
+class Dispatch : public FutureImpl::Listener {
+  Executor& _executor;
+  Task _task;
+
+ public:
+  Dispatch(Executor& executor, const Task& task)
+      : _executor(executor), _task(task) {}
+
+  void complete() {
+    try {
+      _executor.Execute(_task);
+    } catch (...) {
+      /* a canceled executor drops the task */
+    }
+
+    delete this;
+  }
+};
+}
+
+FutureImpl::FutureImpl() : _state(PENDING), _listeners(0), _abandoned(0) {}
+
+FutureImpl::~FutureImpl() {
+  Listener* l = atomic::load(&_listeners);
+  if (l == CLOSED) return;
+
+  while (l) {
+    Listener* next = l->_next;
+    delete l;
+    l = next;
+  }
+}
+
+bool FutureImpl::isDone() { return atomic::load(&_state) >= (long)DONE; }
+
+bool FutureImpl::isFailed() { return atomic::load(&_state) == (long)FAILED; }
+
+const char* FutureImpl::error() { return _error.c_str(); }
+
+bool FutureImpl::claim() {
+  return atomic::cas(&_state, (long)PENDING, (long)SETTING);
+}
+
+void FutureImpl::complete() { publish(DONE); }
+
+bool FutureImpl::fail(const char* msg) {
+  if (!claim()) return false;
+
+  _error = msg ? msg : "";
+  publish(FAILED);
+
+  return true;
+}
+
+bool FutureImpl::push(Listener* l) {
+  // Sweep out the Waiters that timed out or were interrupted, so a future
+  // that is polled with a timeout does not grow its list without bound
+  if (atomic::load(&_abandoned) > 0) reclaim();
+
+  for (;;) {
+    Listener* head = atomic::load(&_listeners);
+    if (head == CLOSED) return false;
+
+    l->_next = head;
+    if (atomic::cas(&_listeners, head, l)) return true;
+  }
+}
+
+void FutureImpl::reclaim() {
+  // Detach the list, listeners pushed meanwhile start a new one. Only the
+  // thread holding a detached node can touch it, so deleting is safe.
+  Listener* head;
+  do {
+    head = atomic::load(&_listeners);
+    if (head == 0 || head == CLOSED) return;
+  } while (!atomic::cas(&_listeners, head, (Listener*)0));
+
+  Listener* kept = 0;
+  Listener** tail = &kept;
+  long n = 0;
+
+  while (head) {
+    Listener* next = head->_next;
+
+    if (head->abandoned()) {
+      delete head;
+      ++n;
+    } else {
+      *tail = head;
+      tail = &head->_next;
+    }
+
+    head = next;
+  }
+
+  *tail = 0;
+  atomic::add(&_abandoned, -n);
+
+  // Put the rest back beneath the listeners pushed meanwhile
+  while (kept) {
+    head = atomic::load(&_listeners);
+
+    if (head == CLOSED) {
+      // The future completed without seeing them, notify them here
+      Listener* ordered = 0;
+      while (kept) {
+        Listener* next = kept->_next;
+        kept->_next = ordered;
+        ordered = kept;
+        kept = next;
+      }
+
+      while (ordered) {
+        Listener* next = ordered->_next;
+        ordered->complete();
+        ordered = next;
+      }
+
+      return;
+    }
+
+    if (head == 0) {
+      if (atomic::cas(&_listeners, head, kept)) return;
+    } else if (atomic::cas(&_listeners, head, (Listener*)0)) {
+      Listener* last = head;
+      while (last->_next) last = last->_next;
+
+      last->_next = kept;
+      kept = head;
+    }
+  }
+}
+
+void FutureImpl::publish(long state) {
+  atomic::store(&_state, state);
+
+  // Close the list so later listeners are notified by listen() instead
+  Listener* l = atomic::exchange(&_listeners, CLOSED);
+
+  // Notify in the order the listeners were added
+  Listener* ordered = 0;
+  while (l) {
+    Listener* next = l->_next;
+    l->_next = ordered;
+    ordered = l;
+    l = next;
+  }
+
+  while (ordered) {
+    Listener* next = ordered->_next;
+    ordered->complete();
+    ordered = next;
+  }
+}
+
+void FutureImpl::listen(Listener* l) {
+  if (!push(l)) l->complete();
+}
+
+void FutureImpl::execute(Executor& executor, const Task& task) {
+  listen(new Dispatch(executor, task));
+}
+
+void FutureImpl::wait() { wait(0); }
+
+bool FutureImpl::wait(unsigned long timeout) {
+  if (isDone()) return true;
+
+  Waiter* w = new Waiter(ThreadImpl::current());
+
+  // Pushed before taking the Monitor, push() may notify other listeners
+  if (!push(w)) {
+    delete w;
+    return true;
+  }
+
+  Monitor& m = w->impl->getMonitor();
+
+  m.Acquire();
+
+  Monitor::STATE state = Monitor::INVALID;
+  bool interrupted = false;
+
+  while (!w->woken) {
+    state = timeout == 0 ? m.wait() : m.wait(timeout);
+
+    if (state == Monitor::TIMEDOUT || state == Monitor::INTERRUPTED) {
+      // Leave the Waiter behind, unless it is being notified at this moment
+      if (w->abandon()) {
+        atomic::add(&_abandoned, 1L);
+        m.Release();
+
+        if (state == Monitor::INTERRUPTED) throw InterruptedException();
+        return false;
+      }
+
+      interrupted = interrupted || state == Monitor::INTERRUPTED;
+    }
+  }
+
+  // Consume the notification so no later wait() by this thread sees it
+  while (w->signaled && state != Monitor::SIGNALED) state = m.wait();
+
+  ThreadImpl* impl = w->impl;
+
+  m.Release();
+  delete w;
+
+  // The future completed anyway; the wait consumed the interruption, so
+  // restore it for the caller to see
+  if (interrupted) impl->interrupt();
+
+  return true;
+}
+
+}  // namespace zthread
@@ -31,31 +31,34 @@
 
 namespace zthread {
 
-AtomicCount::AtomicCount() { value_ = reinterpret_cast<void*>(new long(0)); }
-
-AtomicCount::~AtomicCount() {
-  assert(*reinterpret_cast<long*>(value_) == 0);
-  delete reinterpret_cast<long*>(value_);
+// The count is kept in the storage of value_ itself, it is never larger
+// than a pointer, so creating an AtomicCount does not allocate
+static inline long* counter(void*& value) {
+  return reinterpret_cast<long*>(&value);
 }
 
+AtomicCount::AtomicCount() { *counter(value_) = 0; }
+
+AtomicCount::~AtomicCount() { assert(*counter(value_) == 0); }
+
 //! Postfix decrement and return the previous value
 size_t AtomicCount::operator--(int) {
-	return __sync_fetch_and_sub(reinterpret_cast<long*>(value_), 1);
+	return __sync_fetch_and_sub(counter(value_), 1);
 }
 
 //! Postfix increment and return the previous value
 size_t AtomicCount::operator++(int) {
-	return __sync_fetch_and_add(reinterpret_cast<long*>(value_), 1);
+	return __sync_fetch_and_add(counter(value_), 1);
 }
 
 //! Prefix decrement and return the current value
 size_t AtomicCount::operator--() {
-	return __sync_sub_and_fetch(reinterpret_cast<long*>(value_), 1);
+	return __sync_sub_and_fetch(counter(value_), 1);
 }
 
 //! Prefix increment and return the current value
 size_t AtomicCount::operator++() {
-	return __sync_add_and_fetch(reinterpret_cast<long*>(value_), 1);
+	return __sync_add_and_fetch(counter(value_), 1);
 }
 
 }; // namespace zthread 
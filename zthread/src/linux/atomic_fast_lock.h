@@ -46,7 +46,7 @@ namespace zthread {
  *
  * This implementation of a FastLock uses the atomic operations that
  * linux provides with its kernel sources. This demonstrates how to implement
- * a spinlock with a decrement and test primative.
+ * a spinlock with a compare and swap primative.
  */
 class FastLock : private NonCopyable {
   int _value;
@@ -58,6 +58,10 @@ class FastLock : private NonCopyable {
  public:
   inline FastLock() {
     _value = 1;
+
+#if !defined(NDEBUG)
+    _owner = 0;
+#endif
   }
 
   inline ~FastLock() {
@@ -66,10 +70,9 @@ class FastLock : private NonCopyable {
   }
 
   inline void Acquire() {
-    while (__sync_sub_and_fetch(reinterpret_cast<int*>(&_value), 1) != 0) {
-      __sync_add_and_fetch(reinterpret_cast<int*>(&_value), 1);
-      ThreadOps::yield();
-    }
+    // Only swap in the locked value when the lock is observed free; a
+    // decrement and test would livelock once several threads contend
+    while (!__sync_bool_compare_and_swap(&_value, 1, 0)) ThreadOps::yield();
 
 #if !defined(NDEBUG)
     _owner = pthread_self();
@@ -89,8 +92,7 @@ class FastLock : private NonCopyable {
   }
 
   inline bool TryAcquire(unsigned long timeout = 0) {
-    bool wasLocked = __sync_sub_and_fetch(reinterpret_cast<int*>(&_value), 1) == 0;
-    if (!wasLocked) __sync_add_and_fetch(reinterpret_cast<int*>(&_value), 1);
+    bool wasLocked = __sync_bool_compare_and_swap(&_value, 1, 0);
 
 #if !defined(NDEBUG)
     if (wasLocked) _owner = pthread_self();
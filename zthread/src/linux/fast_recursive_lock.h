@@ -53,11 +53,11 @@ class FastRecursiveLock : private NonCopyable {
 
   inline ~FastRecursiveLock() { pthread_mutex_destroy(&_mtx); }
 
-  inline void acquire() { pthread_mutex_lock(&_mtx); }
+  inline void Acquire() { pthread_mutex_lock(&_mtx); }
 
-  inline void release() { pthread_mutex_unlock(&_mtx); }
+  inline void Release() { pthread_mutex_unlock(&_mtx); }
 
-  inline bool tryAcquire(unsigned long timeout = 0) {
+  inline bool TryAcquire(unsigned long timeout = 0) {
     return (pthread_mutex_trylock(&_mtx) == 0);
   }
 
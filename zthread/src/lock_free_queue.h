@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTLOCKFREEQUEUE_H__
+#define __ZTLOCKFREEQUEUE_H__
+
+#include "atomic_ops.h"
+#include "zthread/non_copyable.h"
+
+namespace zthread {
+
+/**
+ * @class LockFreeQueue
+ *
+ * A bounded multi-producer, multi-consumer FIFO queue that never blocks.
+ * Each cell carries a sequence number telling producers and consumers whose
+ * turn it is, so a successful add() or next() costs a single compare and
+ * swap on the shared position, and producers do not contend with consumers.
+ *
+ * T must be a word sized type, such as a pointer.
+ */
+template <typename T>
+class LockFreeQueue : private NonCopyable {
+  struct Cell {
+    volatile size_t sequence;
+    volatile T item;
+  };
+
+  Cell* _cells;
+  size_t _mask;
+
+  // Kept on separate cache lines, producers only touch the first and
+  // consumers the second
+  char _pad0[64];
+  volatile size_t _enqueue;
+  char _pad1[64];
+  volatile size_t _dequeue;
+  char _pad2[64];
+
+ public:
+  //! Create a queue; the capacity is rounded up to a power of 2
+  LockFreeQueue(size_t capacity = 1024) : _enqueue(0), _dequeue(0) {
+    size_t n = 2;
+    while (n < capacity) n <<= 1;
+
+    _cells = new Cell[n];
+    _mask = n - 1;
+
+    for (size_t i = 0; i < n; ++i) _cells[i].sequence = i;
+  }
+
+  ~LockFreeQueue() { delete[] _cells; }
+
+  /**
+   * Add an item to the end of the queue.
+   *
+   * @return bool false if the queue is full
+   */
+  bool add(T item) {
+    size_t pos = atomic::load(&_enqueue);
+    Cell* cell;
+
+    for (;;) {
+      cell = &_cells[pos & _mask];
+
+      long diff = (long)atomic::load(&cell->sequence) - (long)pos;
+
+      if (diff == 0) {
+        if (atomic::cas(&_enqueue, pos, pos + 1)) break;
+      } else if (diff < 0) {
+        return false;
+      }
+
+      pos = atomic::load(&_enqueue);
+    }
+
+    cell->item = item;
+    atomic::store(&cell->sequence, pos + 1);
+
+    return true;
+  }
+
+  /**
+   * Remove the item at the front of the queue.
+   *
+   * @return bool false if the queue is empty, or if the item at the front
+   *         has not been completely added yet
+   */
+  bool next(T& item) {
+    size_t pos = atomic::load(&_dequeue);
+    Cell* cell;
+
+    for (;;) {
+      cell = &_cells[pos & _mask];
+
+      long diff = (long)atomic::load(&cell->sequence) - (long)(pos + 1);
+
+      if (diff == 0) {
+        if (atomic::cas(&_dequeue, pos, pos + 1)) break;
+      } else if (diff < 0) {
+        return false;
+      }
+
+      pos = atomic::load(&_dequeue);
+    }
+
+    item = cell->item;
+    atomic::store(&cell->sequence, pos + _mask + 1);
+
+    return true;
+  }
+
+  //! Test for items, only a hint while other threads add or remove them
+  bool empty() const {
+    return atomic::load(&_dequeue) == atomic::load(&_enqueue);
+  }
+};
+
+}  // namespace zthread
+
+#endif  // __ZTLOCKFREEQUEUE_H__
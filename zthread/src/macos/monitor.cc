@@ -90,6 +90,10 @@ Monitor::STATE Monitor::wait(unsigned long timeout) {
 
   _waitLock.release();
 
+  // Let the listener know the thread is about to block
+  BlockingListener* listener = _listener;
+  if (listener) listener->blocking();
+
   // Update the wait time
   if (waitDuration != kDurationForever)
     waitDuration = AbsoluteDeltaToDuration(tTarget, UpTime());
@@ -122,6 +126,8 @@ Monitor::STATE Monitor::wait(unsigned long timeout) {
   // Acquire the internal lock & release the external lock
   _waitLock.release();
 
+  if (listener) listener->unblocked();
+
   // Reaquire the external lock, keep from deadlocking threads calling
   // notify(), interrupt(), etc.
   _lock.acquire();
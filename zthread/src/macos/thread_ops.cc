@@ -62,6 +62,23 @@ bool ThreadOps::setPriority(ThreadOps* impl, Priority p) { return true; }
 
 bool ThreadOps::getPriority(ThreadOps* impl, Priority& p) { return true; }
 
+bool ThreadOps::setName(ThreadOps* impl, const char* name) { return false; }
+
+bool ThreadOps::getName(char* name, size_t len) { return false; }
+
+bool ThreadOps::getCpuTime(ThreadOps* impl, unsigned long long& usec) {
+  return false;
+}
+
+bool ThreadOps::setAffinity(size_t n) { return false; }
+
+bool ThreadOps::clearAffinity() { return false; }
+
+size_t ThreadOps::processors() {
+  ItemCount n = MPProcessors();
+  return n > 0 ? (size_t)n : 1;
+}
+
 bool ThreadOps::spawn(Runnable* task) {
   OSStatus status =
       MPCreateTask(&_dispatch, task, 0UL, _queue, NULL, NULL, 0UL, &_tid);
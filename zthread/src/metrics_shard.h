@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTMETRICSSHARD_H__
+#define __ZTMETRICSSHARD_H__
+
+#include "atomic_ops.h"
+#include "zthread/executor_metrics.h"
+#include "zthread/non_copyable.h"
+#include "zthread/time.h"
+
+#include <time.h>
+
+namespace zthread {
+
+/**
+ * @class MetricsShard
+ *
+ * The counters of a single worker. Only the worker that owns a shard
+ * updates it, so recording a task takes no atomic read-modify-write and
+ * the shard's cache lines stay with that worker; a snapshot reads every
+ * shard without stopping them.
+ */
+class MetricsShard : private NonCopyable {
+  typedef ExecutorMetrics::Histogram Histogram;
+
+  enum { BUCKETS = ExecutorMetrics::BUCKETS };
+
+  // Kept off the cache lines of other shards
+  char _pad0[64];
+
+  volatile unsigned long _completed;
+  volatile unsigned long _failed;
+  volatile unsigned long _busy;
+  volatile unsigned long _idle;
+
+  volatile unsigned long _delay[BUCKETS];
+  volatile unsigned long _delayTotal;
+
+  volatile unsigned long _run[BUCKETS];
+  volatile unsigned long _runTotal;
+
+  volatile bool _active;
+  volatile bool _running;
+
+  //! Time the last task ended, or the worker attached
+  volatile unsigned long _last;
+
+  char _pad1[64];
+
+  //! Add to a counter only this thread writes
+  static void bump(volatile unsigned long* p, unsigned long n) {
+    atomic::store(p, *p + n);
+  }
+
+  static size_t bucket(unsigned long us) {
+#if defined(__GNUC__)
+    size_t i = us == 0 ? 0 : sizeof(unsigned long) * 8 - __builtin_clzl(us);
+#else
+    size_t i = 0;
+    for (; us != 0; us >>= 1) ++i;
+#endif
+
+    return i < BUCKETS ? i : BUCKETS - 1;
+  }
+
+  void started(unsigned long delay) {
+    bump(&_delay[bucket(delay)], 1);
+    bump(&_delayTotal, delay);
+  }
+
+  void finished(unsigned long run, bool failed) {
+    bump(&_run[bucket(run)], 1);
+    bump(&_runTotal, run);
+    bump(&_busy, run);
+
+    bump(failed ? &_failed : &_completed, 1);
+  }
+
+  static void collect(const volatile unsigned long* count,
+                      const volatile unsigned long& total, Histogram& h) {
+    for (size_t i = 0; i < BUCKETS; ++i) h.count[i] += atomic::load(&count[i]);
+    h.total += atomic::load(&total);
+  }
+
+ public:
+  MetricsShard()
+      : _completed(0),
+        _failed(0),
+        _busy(0),
+        _idle(0),
+        _delayTotal(0),
+        _runTotal(0),
+        _active(false),
+        _running(false),
+        _last(0) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      _delay[i] = 0;
+      _run[i] = 0;
+    }
+  }
+
+  //! Microseconds on a clock that does not follow changes to the time of
+  //! day, where the platform provides one
+  static unsigned long now() {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+#else
+    Time t;
+    return t.seconds() * 1000000UL + t.milliseconds() * 1000UL;
+#endif
+  }
+
+  bool active() const { return atomic::load(&_active); }
+
+  //! A worker takes over this shard
+  void attach() {
+    atomic::store(&_last, now());
+    atomic::store(&_active, true);
+  }
+
+  //! The worker that owns this shard exits
+  void detach() {
+    bump(&_idle, now() - _last);
+    atomic::store(&_active, false);
+  }
+
+  /**
+   * Record the start of a task, counting the time since the last one as
+   * idle.
+   *
+   * @param queued time the task was submitted
+   * @return unsigned long time the task started
+   */
+  unsigned long begin(unsigned long queued) {
+    unsigned long start = now();
+
+    bump(&_idle, start - _last);
+    atomic::store(&_running, true);
+
+    started(start - queued);
+    return start;
+  }
+
+  //! Record the end of a task that started at the given time
+  void end(unsigned long start, bool failed) {
+    unsigned long last = now();
+    atomic::store(&_last, last);
+
+    finished(last - start, failed);
+    atomic::store(&_running, false);
+  }
+
+  /**
+   * Record a task run by a thread of its own, which is not idle before
+   * the task.
+   *
+   * @param queued time the task was submitted
+   * @param start time the task started
+   * @param failed true if the task propagated an exception
+   */
+  void record(unsigned long queued, unsigned long start, bool failed) {
+    unsigned long last = now();
+    atomic::store(&_last, last);
+
+    started(start - queued);
+    finished(last - start, failed);
+  }
+
+  //! Get the figures of the worker that owns this shard
+  ExecutorMetrics::Worker worker() const {
+    ExecutorMetrics::Worker w;
+
+    w.completed = atomic::load(&_completed);
+    w.failed = atomic::load(&_failed);
+    w.busy = atomic::load(&_busy);
+    w.idle = atomic::load(&_idle);
+    w.active = atomic::load(&_active);
+    w.running = atomic::load(&_running);
+
+    // Count the time the worker has been waiting for its next task
+    if (w.active && !w.running) {
+      unsigned long last = atomic::load(&_last);
+      unsigned long t = now();
+
+      if ((long)(t - last) > 0) w.idle += t - last;
+    }
+
+    return w;
+  }
+
+  //! Add the figures of this shard to the totals of a snapshot
+  void collect(ExecutorMetrics& m) const {
+    ExecutorMetrics::Worker w(worker());
+
+    m.completed += w.completed;
+    m.failed += w.failed;
+    m.busy += w.busy;
+    m.idle += w.idle;
+
+    if (w.running) ++m.running;
+
+    collect(_delay, _delayTotal, m.queueDelay);
+    collect(_run, _runTotal, m.runTime);
+  }
+};
+
+}  // namespace zthread
+
+#endif  // __ZTMETRICSSHARD_H__
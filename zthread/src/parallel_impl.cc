@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/parallel_impl.h"
+#include "zthread/guard.h"
+
+#include "atomic_ops.h"
+#include "thread_impl.h"
+
+#include <vector>
+
+namespace zthread {
+
+namespace {
+
+//! Takes part in a loop from a thread of the executor
+class Helper : public Runnable {
+  CountedPtr<ParallelImpl> _impl;
+
+ public:
+  Helper(const CountedPtr<ParallelImpl>& impl) : _impl(impl) {}
+
+  void run() { _impl->participate(false); }
+};
+}
+
+ParallelImpl::ParallelImpl(size_t begin, size_t end, size_t grain,
+                           size_t participants)
+    : _next(begin),
+      _end(end),
+      _grain(grain == 0 ? 1 : grain),
+      _participants(participants == 0 ? 1 : participants),
+      _joined(0),
+      _remaining(end - begin),
+      _finished(_lock),
+      _done(begin == end),
+      _failed(false) {}
+
+ParallelImpl::~ParallelImpl() {}
+
+bool ParallelImpl::claim(size_t& first, size_t& last) {
+  for (;;) {
+    size_t next = atomic::load(&_next);
+    if (next >= _end) return false;
+
+    // Leave enough for every participant to take a share of its own
+    size_t n = (_end - next) / (2 * _participants);
+    if (n < _grain) n = _grain;
+    if (n > _end - next) n = _end - next;
+
+    if (atomic::cas(&_next, next, next + n)) {
+      first = next;
+      last = next + n;
+
+      return true;
+    }
+  }
+}
+
+void ParallelImpl::finish(size_t n) {
+  if (atomic::add(&_remaining, (size_t)0 - n) != 0) return;
+
+  Guard<FastMutex> g(_lock);
+
+  _done = true;
+  _finished.Broadcast();
+}
+
+void ParallelImpl::fail(const char* error) {
+  {
+    Guard<FastMutex> g(_lock);
+
+    if (_failed) return;
+
+    _error = error;
+    atomic::store(&_failed, true);
+  }
+
+  // Skip what has not been handed out yet
+  size_t next = atomic::exchange(&_next, _end);
+  if (next < _end) finish(_end - next);
+}
+
+void ParallelImpl::wait() {
+  bool interrupted = false;
+
+  {
+    Guard<FastMutex> g(_lock);
+
+    while (!_done) {
+      // Helpers may not notice an interruption meant for the caller, so the
+      // loop is waited for regardless; the body may refer to the caller's
+      // stack
+      try {
+        _finished.Wait();
+      } catch (InterruptedException&) {
+        interrupted = true;
+      }
+    }
+  }
+
+  // The wait consumed the interruption, restore it for the caller to see
+  if (interrupted) ThreadImpl::current()->interrupt();
+}
+
+void ParallelImpl::participate(bool rethrow) {
+  size_t first, last;
+  size_t slot = _participants;
+
+  while (!atomic::load(&_failed) && claim(first, last)) {
+    if (slot == _participants) slot = atomic::add(&_joined, (size_t)1) - 1;
+
+    try {
+      invoke(slot, first, last);
+
+    } catch (const SynchronizationException& e) {
+      fail(e.what());
+      finish(last - first);
+
+      if (rethrow) throw;
+      return;
+
+    } catch (...) {
+      fail("Parallel loop body failed");
+      finish(last - first);
+
+      if (rethrow) throw;
+      return;
+    }
+
+    finish(last - first);
+  }
+}
+
+size_t ParallelImpl::helpers(size_t workers, size_t n, size_t grain) {
+  if (grain == 0) grain = 1;
+
+  size_t chunks = (n + grain - 1) / grain;
+  return chunks > workers ? workers : (chunks > 0 ? chunks - 1 : 0);
+}
+
+void ParallelImpl::run(CountedPtr<ParallelImpl> impl, Executor& executor,
+                       size_t helpers) {
+  if (helpers + 1 > impl->participants()) helpers = impl->participants() - 1;
+
+  if (helpers > 0) {
+    // Helpers are an optimization, the caller gets through the range on
+    // its own if the executor will not take them
+    try {
+      std::vector<Task> tasks(helpers, Task(new Helper(impl)));
+      executor.ExecuteAll(&tasks[0], &tasks[0] + helpers);
+    } catch (...) {
+    }
+  }
+
+  try {
+    impl->participate(true);
+  } catch (...) {
+    impl->wait();
+    throw;
+  }
+
+  impl->wait();
+
+  if (atomic::load(&impl->_failed))
+    throw SynchronizationException(impl->_error.c_str());
+}
+
+}  // namespace zthread
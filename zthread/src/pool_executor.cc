@@ -25,395 +25,1854 @@
  */
 
 #include "zthread/pool_executor.h"
-#include "thread_impl.h"
+#include "atomic_ops.h"
+#include "condition_impl.h"
+#include "lock_free_queue.h"
+#include "metrics_shard.h"
 #include "thread_impl.h"
 #include "thread_queue.h"
+#include "waiter_queue.h"
+#include "work_stealing_deque.h"
+#include "zthread/atomic_count.h"
+#include "zthread/condition.h"
 #include "zthread/fast_mutex.h"
-#include "zthread/monitored_queue.h"
+#include "zthread/guard.h"
+#include "zthread/time.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <utility>
+#include <vector>
+
+using namespace zthread;
+
+namespace zthread {
+
+namespace {
+
+/**
+ * @class GroupedRunnable
+ *
+ * Wrap a task with group and generation information.
+ *
+ * - 'group' is the WaiterQueue slot the task was counted in, so that
+ *   threads waiting on the pool learn when it completes.
+ *
+ * - 'generation' allows tasks to be interrupted
+ *
+ * - 'queued' is the time the task was submitted, for the pool's metrics
+ */
+class GroupedRunnable {
+  //! Empty while the wrapper is spare, a Task cannot be null
+  CountedPtr<Runnable, AtomicCount> _task;
+  WaiterQueue& _queue;
+
+  size_t _group;
+  size_t _generation;
+
+  unsigned long _queued;
+
+ public:
+  GroupedRunnable(WaiterQueue& queue) : _queue(queue) {}
+
+  //! Wrap a task, counting it in the current slot. A GroupedRunnable is
+  //! reused for another task once it has run
+  void assign(const Task& task) {
+    assign(task, _queue.increment(), MetricsShard::now());
+  }
+
+  //! Wrap a task of a batch that has already been counted
+  void assign(const Task& task, const std::pair<size_t, size_t>& pr,
+              unsigned long queued) {
+    _task = task;
+
+    _group = pr.first;
+    _generation = pr.second;
+
+    _queued = queued;
+  }
+
+  //! Release a task that will not be run
+  void abandon() {
+    release();
+    _queue.decrement(group());
+  }
+
+  //! Release a task that will not be run, without counting it as done
+  void release() { _task.reset(); }
+
+  size_t group() const { return _group; }
+
+  size_t generation() const { return _generation; }
+
+  //! Run the task, recording it in the shard of the current worker
+  void run(MetricsShard& shard) {
+    unsigned long start = shard.begin(_queued);
+    bool failed = false;
+
+    try {
+      _task->run();
+
+    } catch (...) {
+      failed = true;
+    }
+
+    shard.end(start, failed);
+
+    // Release the task before anyone waiting for it is woken
+    _task.reset();
+    _queue.decrement(group());
+  }
+};
+
+/**
+ * @class TaskScheduler
+ *
+ * Hands the tasks submitted to a pool to its workers. The scheduler owns
+ * the tasks it holds and deletes any that are never drawn.
+ */
+class TaskScheduler {
+ protected:
+  //! Wake the worker that parked most recently rather than the one that
+  //! has been parked the longest
+  volatile bool _lifo;
+
+ private:
+  //! Workers polling for a task before they park, less those already
+  //! counted on to pick up a task by a submitter
+  volatile long _spinning;
+
+ protected:
+  /**
+   * Leave up to n tasks just queued to the workers polling for one, each
+   * worker taking at most one. Called after the tasks are visible.
+   *
+   * @return size_t number of tasks that still need a parked worker woken
+   */
+  size_t handoff(size_t n) {
+    for (;;) {
+      long spinning = atomic::load(&_spinning);
+      if (spinning <= 0) return n;
+
+      long k = (size_t)spinning < n ? spinning : (long)n;
+      if (atomic::cas(&_spinning, spinning, spinning - k)) return n - k;
+    }
+  }
+
+ public:
+  TaskScheduler() : _lifo(false), _spinning(0) {}
+
+  virtual ~TaskScheduler() {}
+
+  //! Queue a task, throws CancellationException once canceled
+  virtual void add(GroupedRunnable*) = 0;
+
+  //! Queue a batch of tasks, waking at most one worker for each. Once
+  //! canceled, none of them are queued
+  virtual void add(GroupedRunnable** begin, GroupedRunnable** end) = 0;
+
+  //! Queue a task with a priority, which only a scheduler that orders its
+  //! tasks takes into account
+  virtual void add(GroupedRunnable* task, Priority) { add(task); }
+
+  //! Draw a task, blocking until one is available or, unless it is 0, until
+  //! the timeout (milliseconds) expires with TimeoutException. Throws
+  //! CancellationException once canceled and no tasks remain
+  virtual GroupedRunnable* next(unsigned long timeout) = 0;
+
+  //! Draw a task without blocking, false if none is waiting
+  virtual bool draw(GroupedRunnable*& task) = 0;
+
+  //! Take back the task that has been waiting the longest, to make room
+  //! for a newer one; false if no task is waiting
+  virtual bool evict(GroupedRunnable*& task) = 0;
+
+  //! The current worker starts polling for a task with draw()
+  void spin() { atomic::add(&_spinning, 1L); }
+
+  //! The current worker stops polling. Once a submitter has counted on it
+  //! there is nothing left to take back; the worker looks at the queue
+  //! again in next() before it parks
+  void unspin() {
+    for (long spinning = atomic::load(&_spinning); spinning > 0;
+         spinning = atomic::load(&_spinning))
+      if (atomic::cas(&_spinning, spinning, spinning - 1)) break;
+  }
+
+  virtual void cancel() = 0;
+
+  virtual bool isCanceled() = 0;
+
+  //! The current thread is starting to draw tasks
+  virtual void attach() {}
+
+  //! The current thread will draw no more tasks
+  virtual void detach() {}
+
+  void lifo(bool on) { atomic::store(&_lifo, on); }
+
+  bool lifo() { return atomic::load(&_lifo); }
+
+  //! Set the interval (milliseconds) after which a waiting task is promoted
+  virtual void aging(unsigned long) {}
+
+  virtual unsigned long aging() { return 0; }
+};
+
+/**
+ * @class SharedQueueScheduler
+ *
+ * Every worker draws from a single FIFO queue. Workers park on a Condition,
+ * which is only signaled while some worker is waiting and no polling worker
+ * will pick the task up.
+ */
+class SharedQueueScheduler : public TaskScheduler {
+  FastMutex _lock;
+  ConditionImpl<recency_list> _available;
+
+  std::deque<GroupedRunnable*> _queue;
+
+  //! Size of the queue, read without the lock by polling workers
+  volatile size_t _size;
+
+  //! Workers blocked waiting for a task
+  size_t _waiters;
+
+  volatile bool _canceled;
+
+  //! @pre the lock is held
+  GroupedRunnable* pop() {
+    GroupedRunnable* task = _queue.front();
+    _queue.pop_front();
+
+    atomic::store(&_size, _queue.size());
+    return task;
+  }
+
+ public:
+  SharedQueueScheduler()
+      : _available(_lock, recency_list(&_lifo)),
+        _size(0),
+        _waiters(0),
+        _canceled(false) {}
+
+  ~SharedQueueScheduler() {
+    // Release the tasks that were never run
+    for (size_t i = 0; i < _queue.size(); ++i) delete _queue[i];
+  }
+
+  void add(GroupedRunnable* task) { add(&task, &task + 1); }
+
+  void add(GroupedRunnable** begin, GroupedRunnable** end) {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) throw CancellationException();
+
+    _queue.insert(_queue.end(), begin, end);
+    atomic::store(&_size, _queue.size());
+
+    size_t n = handoff(end - begin);
+    for (n = n < _waiters ? n : _waiters; n > 0; --n) _available.signal();
+  }
+
+  GroupedRunnable* next(unsigned long timeout) {
+    Guard<FastMutex> g(_lock);
+
+    for (;;) {
+      if (!_queue.empty()) return pop();
+
+      if (_canceled) throw CancellationException();
+
+      bool signaled = true;
+      ++_waiters;
+
+      try {
+        if (timeout == 0)
+          _available.wait();
+        else
+          signaled = _available.wait(timeout);
+      } catch (...) {
+        --_waiters;
+        throw;
+      }
+
+      --_waiters;
+
+      // A task added as the wait timed out may have signaled no one, take
+      // it on the next pass rather than retire
+      if (!signaled && _queue.empty()) throw TimeoutException();
+    }
+  }
+
+  bool draw(GroupedRunnable*& task) {
+    if (atomic::load(&_size) == 0) return false;
+
+    Guard<FastMutex> g(_lock);
+
+    if (_queue.empty()) return false;
+
+    task = pop();
+    return true;
+  }
+
+  bool evict(GroupedRunnable*& task) { return draw(task); }
+
+  void cancel() {
+    Guard<FastMutex> g(_lock);
+
+    atomic::store(&_canceled, true);
+    _available.broadcast();
+  }
+
+  bool isCanceled() { return atomic::load(&_canceled); }
+};
+
+/**
+ * @class WorkStealingScheduler
+ *
+ * Each worker owns a WorkStealingDeque. Tasks submitted by a worker of the
+ * pool are pushed onto its own deque and run most recent first, so a task
+ * that fans out keeps its working set warm. Tasks submitted from any other
+ * thread go to a shared inject queue. A worker with nothing local to run
+ * takes from the inject queue, then tries to steal from the other workers
+ * starting at a random victim, and only then parks.
+ *
+ * Workers park on a Condition. A submitter only takes the lock to signal
+ * when some worker has announced that it is about to park.
+ */
+class WorkStealingScheduler : public TaskScheduler {
+  typedef WorkStealingDeque<GroupedRunnable*> Deque;
+
+  //! A worker's deque; slots are reused by later workers, never freed
+  //! while the scheduler is alive since thieves may still be reading them
+  struct Slot {
+    Deque tasks;
+    WorkStealingScheduler* owner;
+    unsigned long seed;
+    bool active;
+
+    Slot(WorkStealingScheduler* s, unsigned long n)
+        : owner(s), seed(n * 2654435761UL + 1), active(false) {}
+
+    //! xorshift, picks the first victim to steal from
+    unsigned long random() {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      return seed;
+    }
+  };
+
+  typedef std::vector<Slot*> SlotList;
+
+  //! Serializes the inject queue, the slot list and parking
+  FastMutex _lock;
+  ConditionImpl<recency_list> _available;
+
+  std::deque<GroupedRunnable*> _inject;
+  volatile size_t _injected;
+
+  //! Published copy of the slot list read by thieves without the lock
+  SlotList* volatile _slots;
+
+  //! Replaced copies of the slot list
+  std::vector<SlotList*> _retired;
+
+  //! Workers that are about to park or are parked
+  volatile long _sleepers;
+
+  volatile bool _canceled;
+
+  //! The slot of the current worker, if it works for a WorkStealingScheduler
+  static TSS<Slot*>& current() {
+    static TSS<Slot*> slot;
+    return slot;
+  }
+
+  Slot* local() {
+    Slot* slot = current().get();
+    return (slot && slot->owner == this) ? slot : 0;
+  }
+
+  //! Wake up to n parked workers, if there are any
+  void wake(size_t n) {
+    // Order the push before reading the sleeper count; a worker bumps the
+    // count before it checks the queues a final time
+    atomic::fence();
+
+    size_t sleepers = (size_t)atomic::load(&_sleepers);
+
+    if (sleepers > 0 && (n = handoff(n)) > 0) {
+      Guard<FastMutex> g(_lock);
+
+      for (n = n < sleepers ? n : sleepers; n > 0; --n) _available.signal();
+    }
+  }
+
+  //! Take a task from the inject queue
+  bool poll(GroupedRunnable*& task) {
+    if (atomic::load(&_injected) == 0) return false;
+
+    Guard<FastMutex> g(_lock);
+    return pollLocked(task);
+  }
+
+  bool pollLocked(GroupedRunnable*& task) {
+    if (_inject.empty()) return false;
+
+    task = _inject.front();
+    _inject.pop_front();
+
+    atomic::store(&_injected, _inject.size());
+
+    return true;
+  }
+
+  //! Steal from another worker, starting at a random victim
+  bool steal(Slot* self, GroupedRunnable*& task) {
+    SlotList* slots = atomic::load(&_slots);
+    size_t n = slots->size();
+
+    if (n == 0) return false;
+
+    size_t first = self ? self->random() % n : 0;
+
+    for (size_t i = 0; i < n; ++i) {
+      Slot* victim = (*slots)[(first + i) % n];
+
+      if (victim != self && victim->tasks.steal(task)) return true;
+    }
+
+    return false;
+  }
+
+  //! Test for any visible task, does not claim it
+  bool pending() {
+    if (atomic::load(&_injected) != 0) return true;
+
+    SlotList* slots = atomic::load(&_slots);
+    for (SlotList::iterator i = slots->begin(); i != slots->end(); ++i)
+      if (!(*i)->tasks.empty()) return true;
+
+    return false;
+  }
+
+ public:
+  WorkStealingScheduler()
+      : _available(_lock, recency_list(&_lifo)),
+        _injected(0),
+        _slots(new SlotList),
+        _sleepers(0),
+        _canceled(false) {}
+
+  ~WorkStealingScheduler() {
+    GroupedRunnable* task;
+
+    for (SlotList::iterator i = _slots->begin(); i != _slots->end(); ++i) {
+      while ((*i)->tasks.take(task)) delete task;
+      delete *i;
+    }
+
+    while (pollLocked(task)) delete task;
+
+    delete _slots;
+    for (size_t i = 0; i < _retired.size(); ++i) delete _retired[i];
+  }
+
+  void add(GroupedRunnable* task) { add(&task, &task + 1); }
+
+  void add(GroupedRunnable** begin, GroupedRunnable** end) {
+    if (atomic::load(&_canceled)) throw CancellationException();
+
+    Slot* slot = local();
+
+    if (slot) {
+      for (GroupedRunnable** i = begin; i != end; ++i) slot->tasks.push(*i);
+
+    } else {
+      Guard<FastMutex> g(_lock);
+
+      if (_canceled) throw CancellationException();
+
+      _inject.insert(_inject.end(), begin, end);
+      atomic::store(&_injected, _inject.size());
+    }
+
+    wake(end - begin);
+  }
+
+  GroupedRunnable* next(unsigned long timeout) {
+    Slot* slot = local();
+    GroupedRunnable* task;
+
+    for (;;) {
+      if (slot && slot->tasks.take(task)) return task;
+
+      if (poll(task) || steal(slot, task)) return task;
+
+      Guard<FastMutex> g(_lock);
+
+      if (pollLocked(task)) return task;
+
+      // Announce the intent to park, then look once more so a task pushed
+      // by a submitter that missed the announcement is not stranded
+      atomic::add(&_sleepers, 1L);
+
+      if (pending()) {
+        atomic::add(&_sleepers, -1L);
+        continue;
+      }
+
+      if (_canceled) {
+        atomic::add(&_sleepers, -1L);
+        throw CancellationException();
+      }
+
+      bool signaled = true;
+
+      try {
+        if (timeout == 0)
+          _available.wait();
+        else
+          signaled = _available.wait(timeout);
+      } catch (...) {
+        atomic::add(&_sleepers, -1L);
+        throw;
+      }
+
+      atomic::add(&_sleepers, -1L);
+
+      // A task pushed as the wait timed out may have woken no one
+      if (!signaled) {
+        if (pollLocked(task) || steal(slot, task)) return task;
+
+        throw TimeoutException();
+      }
+    }
+  }
+
+  bool draw(GroupedRunnable*& task) {
+    Slot* slot = local();
+    return (slot && slot->tasks.take(task)) || poll(task) || steal(slot, task);
+  }
+
+  //! The inject queue holds the oldest submissions from outside the pool,
+  //! the top of a deque the oldest of its worker's
+  bool evict(GroupedRunnable*& task) { return poll(task) || steal(0, task); }
+
+  void cancel() {
+    Guard<FastMutex> g(_lock);
+
+    atomic::store(&_canceled, true);
+    _available.broadcast();
+  }
+
+  bool isCanceled() { return atomic::load(&_canceled); }
+
+  void attach() {
+    Guard<FastMutex> g(_lock);
+
+    SlotList* slots = _slots;
+    Slot* slot = 0;
+
+    // Reuse the slot of a worker that has exited
+    for (SlotList::iterator i = slots->begin(); i != slots->end(); ++i)
+      if (!(*i)->active) {
+        slot = *i;
+        break;
+      }
+
+    if (!slot) {
+      slot = new Slot(this, slots->size() + 1);
+
+      // Publish a new copy, thieves may be walking the old one
+      SlotList* copy = new SlotList(*slots);
+      copy->push_back(slot);
+
+      _retired.push_back(slots);
+      atomic::store(&_slots, copy);
+    }
+
+    slot->active = true;
+    current().set(slot);
+  }
+
+  void detach() {
+    Slot* slot = local();
+    if (!slot) return;
+
+    current().set(0);
+
+    Guard<FastMutex> g(_lock);
+
+    // Hand any tasks left behind to the other workers
+    GroupedRunnable* task;
+    bool moved = false;
+
+    while (slot->tasks.take(task)) {
+      _inject.push_back(task);
+      moved = true;
+    }
+
+    atomic::store(&_injected, _inject.size());
+    slot->active = false;
+
+    if (moved) _available.broadcast();
+  }
+};
+
+/**
+ * @class LockFreeQueueScheduler
+ *
+ * Every worker draws from a shared LockFreeQueue, so a hot worker takes a
+ * task without a lock or a system call. Tasks that do not fit in the queue
+ * spill into a locked overflow list, which weakens the FIFO order only
+ * while the queue is full.
+ *
+ * An idle worker parks on its own Monitor after announcing itself in the
+ * parked list. A submitter looks at the number of parked workers after
+ * adding its task and only when that is non-zero does it take the lock and
+ * wake one of them.
+ */
+class LockFreeQueueScheduler : public TaskScheduler {
+  //! A parked worker, lives on the stack of that worker
+  struct Parked {
+    ThreadImpl* impl;
+    volatile bool woken;
+    volatile bool signaled;
+
+    //! Links the workers taken off the parked list to be woken together
+    Parked* next;
+
+    Parked(ThreadImpl* t) : impl(t), woken(false), signaled(false), next(0) {}
+
+    //! Wake the worker; it keeps waiting until this completes
+    void wake() {
+      Monitor& m = impl->getMonitor();
+
+      m.Acquire();
+
+      signaled = m.notify();
+      woken = true;
+
+      m.Release();
+    }
+  };
+
+  LockFreeQueue<GroupedRunnable*> _queue;
+
+  //! Serializes the overflow and parked lists
+  FastMutex _lock;
+
+  std::deque<GroupedRunnable*> _overflow;
+  volatile size_t _overflowed;
+
+  std::deque<Parked*> _parked;
+  volatile size_t _sleepers;
+
+  //! Submissions in progress, a canceled scheduler is drained only once
+  //! none remain
+  volatile long _adding;
+
+  volatile bool _canceled;
+
+  bool poll(GroupedRunnable*& task) {
+    if (_queue.next(task)) return true;
+
+    if (atomic::load(&_overflowed) == 0) return false;
+
+    Guard<FastMutex> g(_lock);
+
+    if (_overflow.empty()) return false;
+
+    task = _overflow.front();
+    _overflow.pop_front();
+
+    atomic::store(&_overflowed, _overflow.size());
+
+    return true;
+  }
+
+  bool pending() {
+    return !_queue.empty() || atomic::load(&_overflowed) != 0;
+  }
+
+  //! Wake up to n parked workers, if there are any
+  void wake(size_t n) {
+    // Order the add before reading the sleeper count; a worker announces
+    // itself before it checks the queue a final time
+    atomic::fence();
+
+    if (atomic::load(&_sleepers) == 0 || (n = handoff(n)) == 0) return;
+
+    Parked* woken = 0;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      for (; n > 0 && !_parked.empty(); --n) {
+        Parked* p = _parked.front();
+        _parked.pop_front();
+
+        p->next = woken;
+        woken = p;
+      }
+
+      atomic::store(&_sleepers, _parked.size());
+    }
+
+    // A worker may return as soon as it is woken, taking its entry with it
+    while (woken) {
+      Parked* p = woken;
+      woken = p->next;
+
+      p->wake();
+    }
+  }
+
+  //! Remove a worker from the parked list; false if it is being woken
+  bool unpark(Parked* p) {
+    Guard<FastMutex> g(_lock);
+
+    std::deque<Parked*>::iterator i =
+        std::find(_parked.begin(), _parked.end(), p);
+
+    if (i == _parked.end()) return false;
+
+    _parked.erase(i);
+    atomic::store(&_sleepers, _parked.size());
+
+    return true;
+  }
+
+  //! Block the current worker until it is woken by wake() or cancel(), or
+  //! until the timeout expires if it is not 0. It then throws a
+  //! TimeoutException, unless there is a task to run
+  void park(unsigned long timeout) {
+    Parked p(ThreadImpl::current());
+    Monitor& m = p.impl->getMonitor();
+
+    m.Acquire();
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      if (_lifo)
+        _parked.push_front(&p);
+      else
+        _parked.push_back(&p);
+
+      atomic::store(&_sleepers, _parked.size());
+    }
+
+    atomic::fence();
+
+    // Look once more, a submitter may have missed the announcement
+    if ((pending() || atomic::load(&_canceled)) && unpark(&p)) {
+      m.Release();
+      return;
+    }
+
+    // Interruption is ignored here; the executor interrupts its workers
+    // only in the hope that they are running a task
+    Monitor::STATE state = Monitor::INVALID;
+
+    while (!p.woken) {
+      state = timeout == 0 ? m.wait() : m.wait(timeout);
+
+      // Unless it is being woken at this moment. A task added as it timed
+      // out may have found no one to wake, so look for one last time
+      if (state == Monitor::TIMEDOUT && unpark(&p)) {
+        m.Release();
+
+        if (pending()) return;
+        throw TimeoutException();
+      }
+    }
+
+    // Consume the notification so no later wait() by this thread sees it
+    while (p.signaled && state != Monitor::SIGNALED) state = m.wait();
+
+    m.Release();
+  }
+
+ public:
+  LockFreeQueueScheduler()
+      : _overflowed(0), _sleepers(0), _adding(0), _canceled(false) {}
+
+  ~LockFreeQueueScheduler() {
+    // Release the tasks that were never run
+    GroupedRunnable* task;
+    while (poll(task)) delete task;
+  }
+
+  void add(GroupedRunnable* task) { add(&task, &task + 1); }
+
+  void add(GroupedRunnable** begin, GroupedRunnable** end) {
+    atomic::add(&_adding, 1L);
+
+    if (atomic::load(&_canceled)) {
+      atomic::add(&_adding, -1L);
+      throw CancellationException();
+    }
+
+    GroupedRunnable** i = begin;
+    while (i != end && _queue.add(*i)) ++i;
+
+    if (i != end) {
+      Guard<FastMutex> g(_lock);
+
+      _overflow.insert(_overflow.end(), i, end);
+      atomic::store(&_overflowed, _overflow.size());
+    }
+
+    atomic::add(&_adding, -1L);
+
+    wake(end - begin);
+  }
+
+  GroupedRunnable* next(unsigned long timeout) {
+    GroupedRunnable* task;
+
+    for (;;) {
+      if (poll(task)) return task;
+
+      if (atomic::load(&_canceled)) {
+        // Let submissions that got in ahead of the cancel finish
+        if (atomic::load(&_adding) != 0) {
+          ThreadImpl::yield();
+          continue;
+        }
+
+        if (poll(task)) return task;
+
+        throw CancellationException();
+      }
+
+      park(timeout);
+    }
+  }
+
+  bool draw(GroupedRunnable*& task) { return poll(task); }
+
+  bool evict(GroupedRunnable*& task) { return poll(task); }
+
+  void cancel() {
+    atomic::exchange(&_canceled, true);
+
+    std::deque<Parked*> parked;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      parked.swap(_parked);
+      atomic::store(&_sleepers, (size_t)0);
+    }
+
+    for (std::deque<Parked*>::iterator i = parked.begin(); i != parked.end();
+         ++i)
+      (*i)->wake();
+  }
+
+  bool isCanceled() { return atomic::load(&_canceled); }
+};
+
+/**
+ * @class PriorityScheduler
+ *
+ * Keeps a FIFO queue for each Priority, and hands out the oldest task of the
+ * most urgent queue first. With aging enabled, each level a task is above
+ * another is worth one aging interval: a task starts before a more urgent
+ * one that was queued more than that many intervals after it, so a steady
+ * stream of urgent tasks cannot starve the others.
+ *
+ * Workers park on a Condition, which is only signaled while some worker is
+ * waiting.
+ */
+class PriorityScheduler : public TaskScheduler {
+  //! A queued task and the time (milliseconds) it was queued, relative to
+  //! the creation of the scheduler
+  struct Entry {
+    GroupedRunnable* task;
+    unsigned long queued;
+
+    Entry(GroupedRunnable* t, unsigned long n) : task(t), queued(n) {}
+  };
+
+  typedef std::deque<Entry> Level;
+
+  enum { LEVELS = High + 1 };
+
+  FastMutex _lock;
+  ConditionImpl<recency_list> _available;
+
+  Level _levels[LEVELS];
+
+  //! Tasks queued on every level, read without the lock by polling workers
+  volatile size_t _size;
+
+  //! Workers blocked waiting for a task
+  size_t _waiters;
+
+  //! Time (milliseconds) a task waits to gain a level, 0 disables aging
+  volatile unsigned long _aging;
+
+  bool _canceled;
+
+  //! Creation time of the scheduler
+  Time _start;
+
+  //! Milliseconds elapsed since the scheduler was created
+  unsigned long now() {
+    Time t;
+    t -= _start;
+
+    return t.seconds() * 1000 + t.milliseconds();
+  }
+
+  static size_t level(Priority p) {
+    return (size_t)p < LEVELS ? (size_t)p : LEVELS - 1;
+  }
+
+  /**
+   * Pick the level to take the next task from. With aging, the oldest task
+   * of each level competes by the time it was queued, put back one aging
+   * interval for every level below the highest; a tie goes to the higher
+   * level.
+   *
+   * @pre the lock is held
+   * @return size_t level, or LEVELS if every level is empty
+   */
+  size_t select() {
+    unsigned long aging = atomic::load(&_aging);
+
+    size_t best = LEVELS;
+    unsigned long due = 0;
+
+    for (size_t i = LEVELS; i-- > 0;) {
+      if (_levels[i].empty()) continue;
+
+      if (aging == 0) return i;
+
+      unsigned long t = _levels[i].front().queued + (LEVELS - 1 - i) * aging;
+
+      if (best == LEVELS || t < due) {
+        best = i;
+        due = t;
+      }
+    }
+
+    return best;
+  }
+
+  //! @pre the lock is held and the level is not empty
+  GroupedRunnable* pop(size_t i) {
+    GroupedRunnable* task = _levels[i].front().task;
+    _levels[i].pop_front();
+
+    atomic::store(&_size, _size - 1);
+    return task;
+  }
+
+ public:
+  PriorityScheduler()
+      : _available(_lock, recency_list(&_lifo)),
+        _size(0),
+        _waiters(0),
+        _aging(0),
+        _canceled(false) {}
+
+  ~PriorityScheduler() {
+    // Release the tasks that were never run
+    for (size_t i = 0; i < LEVELS; ++i)
+      for (Level::iterator j = _levels[i].begin(); j != _levels[i].end(); ++j)
+        delete j->task;
+  }
+
+  void add(GroupedRunnable* task) { add(task, Medium); }
+
+  void add(GroupedRunnable* task, Priority p) {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) throw CancellationException();
+
+    _levels[level(p)].push_back(Entry(task, now()));
+    atomic::store(&_size, _size + 1);
+
+    if (_waiters > 0 && handoff(1) > 0) _available.signal();
+  }
+
+  void add(GroupedRunnable** begin, GroupedRunnable** end) {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) throw CancellationException();
+
+    unsigned long t = now();
+    Level& medium = _levels[level(Medium)];
+
+    for (GroupedRunnable** i = begin; i != end; ++i)
+      medium.push_back(Entry(*i, t));
+
+    size_t n = end - begin;
+    atomic::store(&_size, _size + n);
+
+    n = handoff(n);
+    for (n = n < _waiters ? n : _waiters; n > 0; --n) _available.signal();
+  }
+
+  GroupedRunnable* next(unsigned long timeout) {
+    Guard<FastMutex> g(_lock);
+
+    for (;;) {
+      size_t i = select();
+
+      if (i != LEVELS) return pop(i);
+
+      if (_canceled) throw CancellationException();
+
+      bool signaled = true;
+      ++_waiters;
+
+      try {
+        if (timeout == 0)
+          _available.wait();
+        else
+          signaled = _available.wait(timeout);
+      } catch (...) {
+        --_waiters;
+        throw;
+      }
+
+      --_waiters;
+
+      // A task added as the wait timed out may have signaled no one, take
+      // it on the next pass rather than retire
+      if (!signaled && select() == LEVELS) throw TimeoutException();
+    }
+  }
+
+  bool draw(GroupedRunnable*& task) {
+    if (atomic::load(&_size) == 0) return false;
+
+    Guard<FastMutex> g(_lock);
+
+    size_t i = select();
+    if (i == LEVELS) return false;
+
+    task = pop(i);
+    return true;
+  }
+
+  //! The oldest task of the least urgent level is the one to go
+  bool evict(GroupedRunnable*& task) {
+    Guard<FastMutex> g(_lock);
+
+    for (size_t i = 0; i < LEVELS; ++i)
+      if (!_levels[i].empty()) {
+        task = pop(i);
+        return true;
+      }
+
+    return false;
+  }
+
+  void cancel() {
+    Guard<FastMutex> g(_lock);
+
+    _canceled = true;
+    _available.broadcast();
+  }
+
+  bool isCanceled() {
+    Guard<FastMutex> g(_lock);
+    return _canceled;
+  }
+
+  void aging(unsigned long interval) { atomic::store(&_aging, interval); }
+
+  unsigned long aging() { return atomic::load(&_aging); }
+};
+
+FastMutex poolIdLock;
+size_t lastPoolId = 0;
+
+//! Number the pools so their workers can be told apart
+size_t nextPoolId() {
+  Guard<FastMutex> g(poolIdLock);
+  return ++lastPoolId;
+}
+}
+
+/**
+ *
+ */
+class ExecutorImpl : public BlockingListener {
+  typedef std::deque<ThreadImpl*> ThreadList;
+
+  TaskScheduler* _scheduler;
+  WaiterQueue _waitingQueue;
+
+  //! Wrappers that have run, reused so submitting a task allocates nothing
+  LockFreeQueue<GroupedRunnable*> _spare;
+
+  //! Serializes the worker list
+  FastMutex _lock;
+
+  ThreadList _threads;
+
+  //! Core number of workers, kept even while idle
+  volatile size_t _size;
+
+  //! Number of workers the pool may grow to while tasks are backed up
+  volatile size_t _max;
+
+  //! Time (milliseconds) a worker beyond the core size idles before exiting
+  volatile unsigned long _idleTimeout;
+
+  //! Time (microseconds) an idle worker polls for a task before it parks
+  volatile unsigned long _spin;
+
+  //! Workers registered or starting
+  volatile size_t _count;
+
+  //! Tasks not yet drawn, and workers waiting to draw one
+  volatile long _queued;
+  volatile long _idle;
+
+  //! Most tasks ever waiting to be drawn
+  volatile long _peak;
+
+  //! Most tasks that may wait to be drawn, 0 if unbounded, and what to do
+  //! with a task submitted beyond that
+  volatile size_t _capacity;
+  volatile PoolExecutor::Saturation _saturation;
+  volatile unsigned long _blockTimeout;
+
+  //! Submitters blocked until a task is drawn
+  FastMutex _roomLock;
+  Condition _room;
+  volatile long _blocked;
+
+  //! Most spare workers that may stand in for workers blocked in a task,
+  //! the spares started, and the workers blocked
+  volatile size_t _reserve;
+  volatile size_t _spares;
+  volatile long _stalled;
+
+  //! Thread starting spares, once it is running, whether it was started,
+  //! and whether it is parked waiting to be woken
+  ThreadImpl* volatile _standby;
+  bool _standbyStarted;
+  volatile size_t _parked;
+
+  //! Tasks turned away, dropped to make room, and run by their submitter
+  volatile unsigned long _rejected;
+  volatile unsigned long _dropped;
+  volatile unsigned long _callerRan;
+
+  //! Counters of each worker, reused by later workers once one exits
+  std::vector<MetricsShard*> _shards;
+
+  //! Identifies this pool in the names of its workers
+  size_t _id;
+
+  //! Number of workers started so far
+  size_t _started;
+
+  //! CPU time consumed by workers that have exited (microseconds)
+  unsigned long long _cpuTime;
+
+  //! Most workers the pool may have
+  size_t limit() const { return _max > _size ? _max : _size; }
+
+  //! Remove a worker from the list, false if it was already removed
+  bool remove(ThreadImpl* impl) {
+    ThreadList::iterator i = std::find(_threads.begin(), _threads.end(), impl);
+    if (i == _threads.end()) return false;
+
+    _cpuTime += impl->getCpuTime();
+
+    _threads.erase(i);
+    atomic::store(&_count, _count - 1);
+
+    return true;
+  }
+
+ public:
+  ExecutorImpl(PoolExecutor::Scheduling mode)
+      : _size(0),
+        _max(0),
+        _idleTimeout(60000),
+        _spin(0),
+        _count(0),
+        _queued(0),
+        _idle(0),
+        _peak(0),
+        _capacity(0),
+        _saturation(PoolExecutor::Block),
+        _blockTimeout(0),
+        _room(_roomLock),
+        _blocked(0),
+        _reserve(0),
+        _spares(0),
+        _stalled(0),
+        _standby(0),
+        _standbyStarted(false),
+        _parked(0),
+        _rejected(0),
+        _dropped(0),
+        _callerRan(0),
+        _id(nextPoolId()),
+        _started(0),
+        _cpuTime(0) {
+    if (mode == PoolExecutor::WorkStealing)
+      _scheduler = new WorkStealingScheduler();
+    else if (mode == PoolExecutor::LockFree)
+      _scheduler = new LockFreeQueueScheduler();
+    else if (mode == PoolExecutor::Prioritized)
+      _scheduler = new PriorityScheduler();
+    else
+      _scheduler = new SharedQueueScheduler();
+  }
+
+  ~ExecutorImpl() {
+    delete _scheduler;
+
+    GroupedRunnable* runnable;
+    while (_spare.next(runnable)) delete runnable;
+
+    for (size_t i = 0; i < _shards.size(); ++i) delete _shards[i];
+
+    if (_standby) _standby->delReference();
+  }
+
+  //! Register the current worker, returning the shard it records tasks in
+  MetricsShard& registerThread() {
+    ThreadImpl* impl = ThreadImpl::current();
+    MetricsShard* shard = 0;
+    size_t n;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      _threads.push_back(impl);
+      n = _started++;
+
+      // current cancel if too many threads are being created
+      if (_threads.size() > limit() + _spares) impl->cancel();
+
+      // Take over the shard of a worker that exited
+      for (size_t i = 0; i < _shards.size() && !shard; ++i)
+        if (!_shards[i]->active()) shard = _shards[i];
+
+      if (!shard) {
+        shard = new MetricsShard();
+        _shards.push_back(shard);
+      }
+
+      shard->attach();
+    }
+
+    // Name the worker after its pool, e.g. pool-3-w7
+    char name[32];
+    sprintf(name, "pool-%lu-w%lu", (unsigned long)_id, (unsigned long)n);
+
+    impl->setName(name);
+
+    _scheduler->attach();
+
+    return *shard;
+  }
+
+  void unregisterThread(MetricsShard& shard) {
+    _scheduler->detach();
+
+    Guard<FastMutex> g(_lock);
+
+    remove(ThreadImpl::current());
+    shard.detach();
+  }
+
+  //! A worker could not be started
+  void abandonThread() {
+    Guard<FastMutex> g(_lock);
+    atomic::store(&_count, _count - 1);
+  }
+
+  //! A spare could not be started
+  void abandonSpare() {
+    Guard<FastMutex> g(_lock);
+
+    atomic::store(&_spares, _spares - 1);
+    atomic::store(&_count, _count - 1);
+  }
+
+  //! CPU time consumed by current and former workers (microseconds)
+  unsigned long long cpuTime() {
+    Guard<FastMutex> g(_lock);
+
+    unsigned long long t = _cpuTime;
+    for (ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+      t += (*i)->getCpuTime();
+
+    return t;
+  }
+
+  //! Take a snapshot of the counters of every worker
+  ExecutorMetrics metrics() {
+    ExecutorMetrics m;
+
+    long queued = atomic::load(&_queued);
+
+    m.queued = queued > 0 ? queued : 0;
+    m.peakQueued = atomic::load(&_peak);
+
+    m.rejected = atomic::load(&_rejected);
+    m.dropped = atomic::load(&_dropped);
+    m.callerRan = atomic::load(&_callerRan);
+
+    Guard<FastMutex> g(_lock);
+
+    for (size_t i = 0; i < _shards.size(); ++i) {
+      _shards[i]->collect(m);
+      m.workers.push_back(_shards[i]->worker());
+    }
+
+    return m;
+  }
+
+  //! Claim room for a task in a bounded pool, false if there is none
+  bool reserve() {
+    long capacity = (long)atomic::load(&_capacity);
+
+    for (;;) {
+      long queued = atomic::load(&_queued);
+
+      if (capacity != 0 && queued >= capacity) return false;
+
+      if (atomic::cas(&_queued, queued, queued + 1)) {
+        backlog(queued + 1);
+        return true;
+      }
+    }
+  }
+
+  /**
+   * Wait for room in a bounded pool.
+   *
+   * @return bool false if the timeout expired first
+   */
+  bool await(unsigned long timeout) {
+    Guard<FastMutex> g(_roomLock);
+    Time start;
+
+    atomic::add(&_blocked, 1L);
+
+    bool reserved = false;
+
+    try {
+      for (;;) {
+        if (reserve()) {
+          reserved = true;
+          break;
+        }
+
+        if (_scheduler->isCanceled()) throw CancellationException();
+
+        if (timeout == 0)
+          _room.Wait();
+
+        else {
+          Time now;
+          now -= start;
+
+          unsigned long ms = now.seconds() * 1000 + now.milliseconds();
+          if (ms >= timeout || !_room.Wait(timeout - ms)) break;
+        }
+      }
+
+    } catch (...) {
+      atomic::add(&_blocked, -1L);
+      throw;
+    }
+
+    atomic::add(&_blocked, -1L);
+
+    // Pass on a wakeup this submitter may have consumed without using it
+    if (!reserved && atomic::load(&_blocked) > 0) _room.Signal();
+
+    return reserved;
+  }
+
+  //! Wake a submitter blocked on a full pool, after a task was drawn
+  void vacate() {
+    if (atomic::load(&_blocked) == 0) return;
+
+    Guard<FastMutex> g(_roomLock);
+    _room.Signal();
+  }
+
+  /**
+   * Admit a task to a full pool, according to the saturation policy.
+   *
+   * @param task task being submitted
+   * @param wait false to reject rather than block or run the task
+   * @return bool true if room was made for the task, false if the task
+   *         was run by the caller instead
+   *
+   * @exception RejectedException thrown if the task is turned away
+   */
+  bool saturated(const Task& task, bool wait) {
+    switch (atomic::load(&_saturation)) {
+      case PoolExecutor::Block:
+        if (wait && await(atomic::load(&_blockTimeout))) return true;
+        break;
+
+      case PoolExecutor::CallerRuns:
+        if (!wait) break;
+
+        atomic::add(&_callerRan, 1UL);
+
+        // The task is accepted, so what it throws is not the submitter's
+        // concern, as if a worker had run it
+        try {
+          Task(task)->run();
+        } catch (...) {
+          /* consume the exceptions the work propogates */
+        }
+
+        return false;
+
+      case PoolExecutor::DropOldest:
+        for (;;) {
+          GroupedRunnable* oldest;
+
+          // The dropped task's room is handed straight to the new one
+          if (_scheduler->evict(oldest)) {
+            atomic::add(&_dropped, 1UL);
+
+            oldest->abandon();
+            recycle(oldest);
+
+            return true;
+          }
+
+          // Every waiting task was drawn in the meantime
+          if (reserve()) return true;
+
+          if (_scheduler->isCanceled()) throw CancellationException();
+
+          ThreadImpl::yield();
+        }
+
+      default:
+        break;
+    }
+
+    atomic::add(&_rejected, 1UL);
+    throw RejectedException();
+  }
+
+  /**
+   * Submit a task.
+   *
+   * @param wait false to reject the task instead of blocking or running it
+   *        in the calling thread when a bounded pool is full
+   *
+   * @return bool true if the caller should start another worker, which is
+   *         the case while tasks outnumber the idle workers and the pool
+   *         is below its maximum size.
+   */
+  bool execute(const Task& task, Priority p, bool wait = true) {
+    if (atomic::load(&_capacity) == 0)
+      backlog(atomic::add(&_queued, 1L));
+
+    else if (!reserve() && !saturated(task, wait))
+      return false;
+
+    // Wrap the task with a grouped task
+    GroupedRunnable* runnable;
+
+    if (!_spare.next(runnable)) runnable = new GroupedRunnable(_waitingQueue);
+
+    runnable->assign(task);
+
+    try {
+      _scheduler->add(runnable, p);
+
+    } catch (...) {
+      // Incase the queue is canceled between the time the WaiterQueue is
+      // updated and the task is added to the scheduler
+      atomic::add(&_queued, -1L);
+      vacate();
+
+      runnable->abandon();
+      recycle(runnable);
+      throw;
+    }
+
+    // Workers blocked in their tasks may leave this one waiting
+    if (atomic::load(&_stalled) != 0) compensate();
+
+    return grow(1) != 0;
+  }
+
+  /**
+   * Submit a batch of tasks, counting them with a single atomic add and
+   * handing them to the scheduler all at once.
+   *
+   * @return size_t number of workers the caller should start
+   */
+  size_t executeAll(const Task* begin, const Task* end) {
+    size_t n = end - begin;
+    if (n == 0) return 0;
 
-#include <algorithm>
-#include <deque>
-#include <utility>
+    std::vector<GroupedRunnable*> batch(n);
 
-using namespace zthread;
+    for (size_t i = 0; i < n; ++i)
+      if (!_spare.next(batch[i])) batch[i] = new GroupedRunnable(_waitingQueue);
 
-namespace zthread {
+    std::pair<size_t, size_t> pr(_waitingQueue.increment(n));
+    unsigned long queued = MetricsShard::now();
 
-namespace {
+    for (size_t i = 0; i < n; ++i) batch[i]->assign(begin[i], pr, queued);
 
-/**
- */
-class WaiterQueue {
-  typedef std::deque<ThreadImpl*> ThreadList;
+    backlog(atomic::add(&_queued, (long)n));
 
-  typedef struct group_t {
-    size_t id;
-    size_t count;
-    ThreadList waiters;
-    group_t(size_t n) : id(n), count(0) {}
-  } Group;
+    try {
+      _scheduler->add(&batch[0], &batch[0] + n);
 
-  typedef std::deque<Group> GroupList;
+    } catch (...) {
+      atomic::add(&_queued, -(long)n);
 
-  //! Predicate to find a specific group
-  struct by_id : public std::unary_function<bool, Group> {
-    size_t id;
-    by_id(size_t n) : id(n) {}
-    bool operator()(const Group& grp) { return grp.id == id; }
-  };
+      for (size_t i = 0; i < n; ++i) {
+        batch[i]->release();
+        recycle(batch[i]);
+      }
 
-  //! Functor to count groups
-  struct counter : public std::unary_function<void, Group> {
-    size_t count;
-    counter() : count(0) {}
-    void operator()(const Group& grp) { count += grp.count; }
-    operator size_t() { return count; }
-  };
+      _waitingQueue.decrement(pr.first, n);
+      throw;
+    }
 
-  FastMutex _lock;
-  GroupList _list;
-  size_t _id;
-  size_t _generation;
+    if (atomic::load(&_stalled) != 0) compensate();
 
- public:
-  WaiterQueue() : _id(0), _generation(0) {
-    // At least one empty-group exists
-    _list.push_back(Group(_id++));
+    return grow(n);
   }
 
   /**
-   * Insert the current thread into the current waiter list
+   * Reserve up to n new workers for the tasks that outnumber the idle
+   * workers, without growing the pool beyond its maximum size.
    *
-   * @pre  At least one empty group exists
-   * @post At least one empty group exists
+   * @return size_t number of workers the caller should start
    */
-  bool wait(unsigned long timeout) {
-    ThreadImpl* current = ThreadImpl::current();
-    Monitor& m = current->getMonitor();
+  size_t grow(size_t n) {
+    long backlog = atomic::load(&_queued) - atomic::load(&_idle);
 
-    Monitor::STATE state;
+    if (backlog <= 0 || atomic::load(&_count) >= atomic::load(&_max))
+      return 0;
 
-    Guard<FastMutex> g1(_lock);
+    Guard<FastMutex> g(_lock);
 
-    // At least one empty-group exists
-    assert(!_list.empty());
+    if (_count >= _max) return 0;
 
-    // Return w/o waiting if there are no executing tasks
-    if ((size_t)std::for_each(_list.begin(), _list.end(), counter()) < 1)
-      return true;
+    if ((size_t)backlog < n) n = backlog;
+    if (_max - _count < n) n = _max - _count;
 
-    // Update the waiter list for the active group
-    _list.back().waiters.push_back(current);
-    size_t n = _list.back().id;
+    atomic::store(&_count, _count + n);
+    return n;
+  }
 
-    m.Acquire();
+  //! Note the number of tasks waiting to be drawn, keeping the peak
+  void backlog(long queued) {
+    for (long peak = atomic::load(&_peak); queued > peak;
+         peak = atomic::load(&_peak))
+      if (atomic::cas(&_peak, peak, queued)) break;
+  }
 
-    {
-      Guard<FastMutex, UnlockedScope> g2(g1);
-      state = timeout == 0 ? m.wait() : m.wait(timeout);
-    }
+  //! Keep a wrapper that has run for another task
+  void recycle(GroupedRunnable* runnable) {
+    if (!_spare.add(runnable)) delete runnable;
+  }
 
-    m.Release();
+  void interrupt() {
+    // Bump the generation number
+    _waitingQueue.generation(true);
 
-    // If awoke due to a reason other than the last task in the group 'n'
-    // completing,
-    // then then find the group 'current' is waiting in
-    GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-    if (i != _list.end()) {
-      // Remove 'current' from that list if it is still a member
-      ThreadList::iterator j =
-          std::find(i->waiters.begin(), i->waiters.end(), current);
-      if (j != i->waiters.end()) i->waiters.erase(j);
-    }
+    Guard<FastMutex> g(_lock);
 
-    // At least one empty-group exists
-    assert(!_list.empty());
+    // Interrupt all threads currently running, thier tasks would be
+    // from an older generation
+    for (ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+      (*i)->interrupt();
+  }
 
-    switch (state) {
-      case Monitor::SIGNALED:
-        break;
-      case Monitor::TIMEDOUT:
-        return false;
-      case Monitor::INTERRUPTED:
-        throw InterruptedException();
-      default:
-        throw SynchronizationException();
-    }
+  //! Adjust the number of desired workers and return the number of Threads
+  //! needed
+  size_t workers(size_t n) {
+    Guard<FastMutex> g(_lock);
 
-    return true;
+    size_t m = (_count < n) ? (n - _count) : 0;
+
+    _size = n;
+    atomic::store(&_count, _count + m);
+
+    return m;
   }
 
-  /**
-   * Increment the active group count
-   *
-   * @pre at least 1 empty group exists
-   * @post at least 1 non-empty group exists
-   */
-  std::pair<size_t, size_t> increment() {
+  size_t workers() {
     Guard<FastMutex> g(_lock);
+    return _size;
+  }
 
-    // At least one empty-group exists
-    assert(!_list.empty());
-
-    GroupList::iterator i = --_list.end();
-    size_t n = i->id;
+  void maxWorkers(size_t n) {
+    Guard<FastMutex> g(_lock);
+    _max = n;
+  }
 
-    if (i == _list.end()) {
-      // A group should never have been removed until
-      // the final task in that group completed
-      assert(0);
-    }
+  size_t maxWorkers() {
+    Guard<FastMutex> g(_lock);
+    return limit();
+  }
 
-    i->count++;
+  void capacity(size_t n) {
+    atomic::store(&_capacity, n);
 
-    // When the active group is being incremented, insert a new active group
-    // to replace it if there were waiting threads
-    if (i == --_list.end() && !i->waiters.empty())
-      _list.push_back(Group(_id++));
+    // Submitters blocked on the old capacity may fit now
+    Guard<FastMutex> g(_roomLock);
+    _room.Broadcast();
+  }
 
-    // At least 1 non-empty group exists
-    assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
+  size_t capacity() { return atomic::load(&_capacity); }
 
-    return std::make_pair(n, _generation);
+  void saturation(PoolExecutor::Saturation policy, unsigned long timeout) {
+    atomic::store(&_saturation, policy);
+    atomic::store(&_blockTimeout, timeout);
   }
 
+  PoolExecutor::Saturation saturation() { return atomic::load(&_saturation); }
+
+  void idleTimeout(unsigned long timeout) { _idleTimeout = timeout; }
+
+  unsigned long idleTimeout() { return _idleTimeout; }
+
+  void idleSpin(unsigned long usec) { atomic::store(&_spin, usec); }
+
+  unsigned long idleSpin() { return atomic::load(&_spin); }
+
   /**
-   * Decrease the count for the group with the given id.
+   * Set the most spare workers that may be started.
    *
-   * @param n group id
-   *
-   * @pre  At least 1 non-empty group exists
-   * @post At least 1 empty group exists
+   * @return bool true if the caller should start the thread starting them
    */
-  void decrement(size_t n) {
-    Guard<FastMutex> g1(_lock);
-
-    // At least 1 non-empty group exists
-    assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
-
-    // Find the requested group
-    GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-    if (i == _list.end()) {
-      // A group should never have been removed until
-      // the final task in that group completed
-      assert(0);
-    }
-
-    // Decrease the count for tasks in this group,
-    if (--i->count == 0 && i == _list.begin()) {
-      do {
-        // When the first group completes, wake all waiters for every
-        // group, starting from the first until a group that is not
-        // complete is reached
-
-        /*
-        // Don't remove the empty active group
-        if(i == --_list.end() && i->waiters.empty())
-          break;
-        */
-
-        if (awaken(*i)) {
-          // If all waiters were awakened, remove the group
-          i = _list.erase(i);
-
-        } else {
-          {
-            // Otherwise, unlock and yield allowing the waiter
-            // lists to be updated if other threads are busy
-            Guard<FastLock, UnlockedScope> g2(g1);
-            ThreadImpl::yield();
-          }
+  bool compensation(size_t n) {
+    atomic::store(&_reserve, n);
 
-          i = _list.begin();
-        }
+    Guard<FastMutex> g(_lock);
 
-      } while (i != _list.end() && i->count == 0);
+    if (n == 0 || _standbyStarted) return false;
 
-      // Ensure that an active group exists
-      if (_list.empty()) _list.push_back(Group(++_id));
-    }
+    _standbyStarted = true;
+    return true;
+  }
+
+  size_t compensation() { return atomic::load(&_reserve); }
+
+  //! True while a worker blocked in its task leaves a task waiting, and
+  //! the pool has spares left to stand in for it
+  bool understaffed() {
+    long stalled = atomic::load(&_stalled);
+    size_t spares = atomic::load(&_spares);
 
-    // At least one group exists
-    assert(!_list.empty());
+    return stalled > (long)spares && spares < atomic::load(&_reserve) &&
+           atomic::load(&_queued) - atomic::load(&_idle) > 0;
   }
 
   /**
+   * Wake the thread starting spares, if one is needed. This runs inside the
+   * wait() of a blocking worker, so it must not block or wait itself; an
+   * interrupt() only touches the state of the thread it wakes.
    */
-  size_t generation(bool next = false) {
-    Guard<FastMutex> g(_lock);
-    return next ? _generation++ : _generation;
+  void compensate() {
+    if (understaffed()) wake();
   }
 
- private:
+  //! Interrupt the thread starting spares if it is parked. Only the one
+  //! thread that unparks it interrupts it, since a thread that is starting
+  //! another must not be interrupted
+  void wake() {
+    if (atomic::cas(&_parked, (size_t)1, (size_t)0))
+      atomic::load(&_standby)->interrupt();
+  }
+
+  //! A worker is about to block in its task
+  void blocking() {
+    atomic::add(&_stalled, 1L);
+    compensate();
+  }
+
+  //! A worker blocked in its task has resumed
+  void unblocked() { atomic::add(&_stalled, -1L); }
+
   /**
-   * Awaken all the waiters remaining in the given group
+   * Wait until a spare is needed, and reserve it.
    *
-   * @return
-   *   - true if all the waiting threads were successfully awakened.
-   *   - false if there were one or more threads that could not be awakened.
+   * @return bool false once the pool has been canceled
    */
-  bool awaken(Group& grp) {
-    // Go through the waiter list in the given group;
-    for (ThreadList::iterator i = grp.waiters.begin();
-         i != grp.waiters.end();) {
-      ThreadImpl* impl = *i;
-      Monitor& m = impl->getMonitor();
-
-      // Try the monitor lock, if it cant be locked skip to the next waiter
-      if (m.TryAcquire()) {
-        // Notify the monitor & remove from the waiter list so time isn't
-        // wasted checking it again.
-        i = grp.waiters.erase(i);
-
-        // Try to wake the waiter, it doesn't matter if this is successful
-        // or not (only fails when the monitor is already going to stop
-        // waiting).
-        m.notify();
-        m.Release();
+  bool standby() {
+    ThreadImpl* impl = ThreadImpl::current();
 
-      } else
-        ++i;
+    if (!atomic::load(&_standby)) {
+      impl->addReference();
+      atomic::store(&_standby, impl);
     }
 
-    return grp.waiters.empty();
-  }
-};
-
-/**
- * @class GroupedRunnable
- *
- * Wrap a task with group and generation information.
- *
- * - 'group' allows tasks to be grouped together so that lists of waiting
- *   threads can be managed.
- *
- * - 'generation' allows tasks to be interrupted
- */
-class GroupedRunnable : public Runnable {
-  Task _task;
-  WaiterQueue& _queue;
+    Monitor& m = impl->getMonitor();
 
-  size_t _group;
-  size_t _generation;
+    for (;;) {
+      if (_scheduler->isCanceled()) return false;
 
- public:
-  GroupedRunnable(const Task& task, WaiterQueue& queue)
-      : _task(task), _queue(queue) {
-    std::pair<size_t, size_t> pr(_queue.increment());
+      if (understaffed()) {
+        Guard<FastMutex> g(_lock);
 
-    _group = pr.first;
-    _generation = pr.second;
-  }
+        if (_spares < _reserve) {
+          atomic::store(&_spares, _spares + 1);
+          atomic::store(&_count, _count + 1);
 
-  size_t group() const { return _group; }
+          return true;
+        }
+      }
 
-  size_t generation() const { return _generation; }
+      // Park until compensate() or cancel() wakes this thread, unless a
+      // spare was needed in the meantime and nothing has woken it yet
+      Guard<Monitor> g(m);
+      atomic::exchange(&_parked, (size_t)1);
 
-  void run() {
-    try {
-      _task->run();
+      if ((_scheduler->isCanceled() || understaffed()) &&
+          atomic::cas(&_parked, (size_t)1, (size_t)0))
+        continue;
 
-    } catch (...) {
+      while (m.wait() != Monitor::INTERRUPTED) {
+      }
     }
-
-    _queue.decrement(group());
   }
-};
 
-typedef CountedPtr<GroupedRunnable, size_t> ExecutorTask;
-}
+  //! Remove the current worker if there are more spares than workers
+  //! blocked, true if it should exit
+  bool retire() {
+    if (atomic::load(&_spares) == 0) return false;
 
-/**
- *
- */
-class ExecutorImpl {
-  typedef MonitoredQueue<ExecutorTask, FastMutex> TaskQueue;
-  typedef std::deque<ThreadImpl*> ThreadList;
+    Guard<FastMutex> g(_lock);
 
-  TaskQueue _taskQueue;
-  WaiterQueue _waitingQueue;
+    long stalled = atomic::load(&_stalled);
+    if (_spares == 0 || (long)_spares <= stalled) return false;
 
-  ThreadList _threads;
-  volatile size_t _size;
+    atomic::store(&_spares, _spares - 1);
+    remove(ThreadImpl::current());
 
- public:
-  ExecutorImpl() : _size(0) {}
+    return true;
+  }
 
-  void registerThread() {
-    Guard<TaskQueue> g(_taskQueue);
+  void aging(unsigned long interval) { _scheduler->aging(interval); }
 
-    ThreadImpl* impl = ThreadImpl::current();
-    _threads.push_back(impl);
+  unsigned long aging() { return _scheduler->aging(); }
 
-    // current cancel if too many threads are being created
-    if (_threads.size() > _size) impl->cancel();
+  void wakeOrder(PoolExecutor::WakeOrder order) {
+    _scheduler->lifo(order == PoolExecutor::MostRecentlyIdle);
   }
 
-  void unregisterThread() {
-    Guard<TaskQueue> g(_taskQueue);
-    std::remove(_threads.begin(), _threads.end(), ThreadImpl::current());
+  PoolExecutor::WakeOrder wakeOrder() {
+    return _scheduler->lifo() ? PoolExecutor::MostRecentlyIdle
+                              : PoolExecutor::LongestIdle;
   }
 
-  void execute(const Task& task) {
-    // Wrap the task with a grouped task
-    GroupedRunnable* runnable = new GroupedRunnable(task, _waitingQueue);
+  /**
+   * Poll for a task for the configured time, then a few times more between
+   * yielding the processor, before the current worker parks. A submitter
+   * that sees the worker polling leaves the task to it rather than waking
+   * a parked one.
+   *
+   * @return GroupedRunnable* the task drawn, or 0
+   */
+  GroupedRunnable* spin() {
+    unsigned long usec = atomic::load(&_spin);
+    GroupedRunnable* task = 0;
 
-    try {
-      _taskQueue.Add(ExecutorTask(runnable));
+    if (usec == 0) return 0;
 
-    } catch (...) {
-      // Incase the queue is canceled between the time the WaiterQueue is
-      // updated and the task is added to the TaskQueue
-      _waitingQueue.decrement(runnable->group());
-      throw;
-    }
-  }
+    _scheduler->spin();
 
-  void interrupt() {
-    // Bump the generation number
-    _waitingQueue.generation(true);
+    unsigned long start = MetricsShard::now();
+    bool drawn = false;
 
-    Guard<TaskQueue> g(_taskQueue);
+    while (!(drawn = _scheduler->draw(task)) && !_scheduler->isCanceled()) {
+      for (int i = 0; i < 16; ++i) atomic::pause();
 
-    // Interrupt all threads currently running, thier tasks would be
-    // from an older generation
-    for (ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
-      (*i)->interrupt();
-  }
+      if (MetricsShard::now() - start >= usec) break;
+    }
 
-  //! Adjust the number of desired workers and return the number of Threads
-  //! needed
-  size_t workers(size_t n) {
-    Guard<TaskQueue> g(_taskQueue);
+    for (int i = 0; i < 8 && !drawn && ThreadOps::yield(); ++i)
+      drawn = _scheduler->draw(task);
 
-    size_t m = (_size < n) ? (n - _size) : 0;
-    _size = n;
+    _scheduler->unspin();
 
-    return m;
+    return drawn ? task : 0;
   }
 
-  size_t workers() {
-    Guard<TaskQueue> g(_taskQueue);
-    return _size;
-  }
+  //! Draw the next task, or 0 if the current worker should exit because
+  //! the pool has been idle above its core size
+  GroupedRunnable* next() {
+    GroupedRunnable* task = 0;
 
-  ExecutorTask next() {
-    ExecutorTask task;
+    // A spare exits once the worker it stood in for resumes
+    if (retire()) return 0;
 
-    // Draw the task from the queue
-    for (;;) {
+    atomic::add(&_idle, 1L);
+
+    // Poll before parking, then draw the task from the queue
+    for (task = spin(); !task;) {
       try {
-        task = _taskQueue.Next();
+        // Workers beyond the core size wait only so long
+        unsigned long timeout = 0;
+        if (atomic::load(&_count) > atomic::load(&_size))
+          timeout = _idleTimeout == 0 ? 1 : _idleTimeout;
+
+        task = _scheduler->next(timeout);
         break;
 
+      } catch (TimeoutException&) {
+        Guard<FastMutex> g(_lock);
+
+        if (_spares > 0 && (long)_spares > atomic::load(&_stalled)) {
+          atomic::store(&_spares, _spares - 1);
+          remove(ThreadImpl::current());
+          break;
+        }
+
+        if (_count > _size + _spares) {
+          remove(ThreadImpl::current());
+          break;
+        }
+
       } catch (InterruptedException&) {
         // Ignore interruption here, it can only come from
         // another thread interrupt()ing the executor. The
         // thread was interrupted in the hopes it was busy
         // with a task
+
+      } catch (...) {
+        atomic::add(&_idle, -1L);
+        throw;
       }
     }
 
+    atomic::add(&_idle, -1L);
+
+    if (!task) return 0;
+
+    atomic::add(&_queued, -1L);
+    vacate();
+
     // Interrupt the thread running the tasks when the generation
     // does not match the current generation
     if (task->generation() != _waitingQueue.generation())
@@ -427,9 +1886,18 @@ class ExecutorImpl {
     return task;
   }
 
-  bool isCanceled() { return _taskQueue.IsCanceled(); }
+  bool isCanceled() { return _scheduler->isCanceled(); }
+
+  void cancel() {
+    _scheduler->cancel();
 
-  void cancel() { _taskQueue.Cancel(); }
+    // The thread starting spares exits
+    wake();
+
+    // Submitters blocked on a full pool give up
+    Guard<FastMutex> g(_roomLock);
+    _room.Broadcast();
+  }
 
   bool wait(unsigned long timeout) { return _waitingQueue.wait(timeout); }
 };
@@ -443,22 +1911,57 @@ class Worker : public Runnable {
   //! Create a Worker that draws upon the given Queue
   Worker(const CountedPtr<ExecutorImpl>& impl) : _impl(impl) {}
 
-  //! Run until Thread or Queue are canceled
+  //! Run until Thread or Queue are canceled, or until the pool retires
+  //! this worker
   void run() {
-    _impl->registerThread();
+    MetricsShard& shard = _impl->registerThread();
+    Monitor& monitor = ThreadImpl::current()->getMonitor();
 
     // Run until the Queue is canceled
-    while (!Thread::canceled()) {
-      // Draw tasks from the queue
-      ExecutorTask task(_impl->next());
-      task->run();
+    try {
+      while (!Thread::canceled()) {
+        // Draw tasks from the queue
+        GroupedRunnable* task = _impl->next();
+        if (!task) break;
+
+        // Let the pool stand in for the worker while its task blocks
+        if (_impl->compensation() != 0) monitor.listen(&*_impl);
+
+        task->run(shard);
+        monitor.listen(0);
+
+        _impl->recycle(task);
+      }
+
+    } catch (CancellationException&) {
+      // The Queue was canceled while waiting for a task
     }
 
-    _impl->unregisterThread();
+    _impl->unregisterThread(shard);
   }
 
 }; /* Worker */
 
+//! Starts a spare worker whenever one is needed
+class Standby : public Runnable {
+  CountedPtr<ExecutorImpl> _impl;
+
+ public:
+  Standby(const CountedPtr<ExecutorImpl>& impl) : _impl(impl) {}
+
+  void run() {
+    while (_impl->standby()) {
+      try {
+        Thread t(new Worker(_impl));
+      } catch (...) {
+        _impl->abandonSpare();
+        ThreadImpl::yield();
+      }
+    }
+  }
+
+}; /* Standby */
+
 //! Helper
 class Shutdown : public Runnable {
   CountedPtr<ExecutorImpl> _impl;
@@ -471,14 +1974,26 @@ class Shutdown : public Runnable {
 }; /* Shutdown */
 }
 
-PoolExecutor::PoolExecutor(size_t n)
-    : _impl(new ExecutorImpl()), _shutdown(new Shutdown(_impl)) {
+PoolExecutor::PoolExecutor(size_t n, Scheduling mode)
+    : _impl(new ExecutorImpl(mode)), _shutdown(new Shutdown(_impl)) {
   size(n);
 
   // Request cancelation when main() exits
   ThreadQueue::instance()->insertShutdownTask(_shutdown);
 }
 
+PoolExecutor::PoolExecutor(size_t core, size_t max, unsigned long timeout,
+                           Scheduling mode)
+    : _impl(new ExecutorImpl(mode)), _shutdown(new Shutdown(_impl)) {
+  _impl->maxWorkers(max);
+  _impl->idleTimeout(timeout);
+
+  size(core);
+
+  // Request cancelation when main() exits
+  ThreadQueue::instance()->insertShutdownTask(_shutdown);
+}
+
 PoolExecutor::~PoolExecutor() {
   try {
     /**
@@ -497,15 +2012,118 @@ void PoolExecutor::Interrupt() { _impl->interrupt(); }
 void PoolExecutor::size(size_t n) {
   if (n < 1) throw InvalidOpException();
 
-  for (size_t m = _impl->workers(n); m > 0; --m) Thread t(new Worker(_impl));
+  for (size_t m = _impl->workers(n); m > 0; --m) {
+    try {
+      Thread t(new Worker(_impl));
+    } catch (...) {
+      _impl->abandonThread();
+      throw;
+    }
+  }
 }
 
 size_t PoolExecutor::size() { return _impl->workers(); }
 
-void PoolExecutor::Execute(const Task& task) {
+void PoolExecutor::maxSize(size_t n) { _impl->maxWorkers(n); }
+
+size_t PoolExecutor::maxSize() { return _impl->maxWorkers(); }
+
+void PoolExecutor::idleTimeout(unsigned long timeout) {
+  _impl->idleTimeout(timeout);
+}
+
+unsigned long PoolExecutor::idleTimeout() { return _impl->idleTimeout(); }
+
+void PoolExecutor::idleSpin(unsigned long usec) { _impl->idleSpin(usec); }
+
+unsigned long PoolExecutor::idleSpin() { return _impl->idleSpin(); }
+
+void PoolExecutor::compensation(size_t n) {
+  if (_impl->compensation(n)) Thread t(new Standby(_impl));
+}
+
+size_t PoolExecutor::compensation() { return _impl->compensation(); }
+
+void PoolExecutor::capacity(size_t n) { _impl->capacity(n); }
+
+size_t PoolExecutor::capacity() { return _impl->capacity(); }
+
+void PoolExecutor::saturation(Saturation policy, unsigned long timeout) {
+  _impl->saturation(policy, timeout);
+}
+
+PoolExecutor::Saturation PoolExecutor::saturation() {
+  return _impl->saturation();
+}
+
+unsigned long long PoolExecutor::getCpuTime() { return _impl->cpuTime(); }
+
+ExecutorMetrics PoolExecutor::getMetrics() { return _impl->metrics(); }
+
+void PoolExecutor::aging(unsigned long interval) { _impl->aging(interval); }
+
+unsigned long PoolExecutor::aging() { return _impl->aging(); }
+
+void PoolExecutor::wakeOrder(WakeOrder order) { _impl->wakeOrder(order); }
+
+PoolExecutor::WakeOrder PoolExecutor::wakeOrder() {
+  return _impl->wakeOrder();
+}
+
+void PoolExecutor::Execute(const Task& task) { Execute(task, Medium); }
+
+void PoolExecutor::Execute(const Task& task, Priority p) {
   // Enqueue the task, the Queue will reject it with a
   // Cancelation_Exception if the Executor has been canceled
-  _impl->execute(task);
+  if (!_impl->execute(task, p)) return;
+
+  // Grow the pool to keep up with a burst; the task is already queued, so
+  // failing to start a worker is not an error
+  try {
+    Thread t(new Worker(_impl));
+  } catch (...) {
+    _impl->abandonThread();
+  }
+}
+
+void PoolExecutor::Execute(const Task& task, CancellationToken token,
+                           Priority p) {
+  Execute(token.bind(task), p);
+}
+
+bool PoolExecutor::TryExecute(const Task& task, Priority p) {
+  try {
+    if (!_impl->execute(task, p, false)) return true;
+  } catch (RejectedException&) {
+    return false;
+  }
+
+  try {
+    Thread t(new Worker(_impl));
+  } catch (...) {
+    _impl->abandonThread();
+  }
+
+  return true;
+}
+
+void PoolExecutor::ExecuteAll(const Task* begin, const Task* end) {
+  // A bounded pool admits each task on its own
+  if (_impl->capacity() != 0) {
+    for (; begin != end; ++begin) Execute(*begin);
+    return;
+  }
+
+  size_t n = _impl->executeAll(begin, end);
+
+  // Grow the pool to keep up with the batch, as Execute() would
+  for (; n > 0; --n) {
+    try {
+      Thread t(new Worker(_impl));
+    } catch (...) {
+      _impl->abandonThread();
+    }
+  }
 }
 
 void PoolExecutor::Cancel() { _impl->cancel(); }
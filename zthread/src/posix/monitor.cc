@@ -71,6 +71,27 @@ Monitor::STATE Monitor::wait(unsigned long ms) {
   // Access to the state is still serial.
   _lock.Release();
 
+  // Let the listener know the thread is about to block. It is told without
+  // holding the wait lock, as it may wake other threads, so the state is
+  // checked again afterwards
+  BlockingListener* listener = _listener;
+
+  if (listener) {
+    pthread_mutex_unlock(&_waitLock);
+    listener->blocking();
+    pthread_mutex_lock(&_waitLock);
+
+    if (pending(ANYTHING)) {
+      state = next();
+
+      pthread_mutex_unlock(&_waitLock);
+      listener->unblocked();
+
+      _lock.Acquire();
+      return state;
+    }
+  }
+
   // Wait for a transition in the state that is of interest, this
   // allows waits to exclude certain flags (e.g. INTERRUPTED)
   // for a single wait() w/o actually discarding those flags -
@@ -125,6 +146,8 @@ Monitor::STATE Monitor::wait(unsigned long ms) {
 
   pthread_mutex_unlock(&_waitLock);
 
+  if (listener) listener->unblocked();
+
   // Reaquire the external lock, keep from deadlocking threads calling
   // notify(), interrupt(), etc.
 
@@ -159,6 +182,9 @@ bool Monitor::interrupt() {
 }
 
 bool Monitor::isInterrupted() {
+  // Nothing to report or clear; the common case needs no lock
+  if ((snapshot() & _mask & INTERRUPTED) == 0) return false;
+
   // Serialize access to the state
   pthread_mutex_lock(&_waitLock);
 
@@ -172,12 +198,22 @@ bool Monitor::isInterrupted() {
 }
 
 bool Monitor::isCanceled() {
+  unsigned short pending = snapshot();
+
+  // Nothing to report or clear; the common case needs no lock
+  if ((pending & (CANCELED | INTERRUPTED)) == 0) return false;
+
+  // CANCELED is never cleared, so only the owner (which must also clear
+  // INTERRUPTED) needs to serialize
+  bool isOwner = pthread_equal(_owner, pthread_self());
+  if (!isOwner) return (pending & CANCELED) != 0;
+
   // Serialize access to the state
   pthread_mutex_lock(&_waitLock);
 
   bool wasCanceled = examine(CANCELED);
 
-  if (pthread_equal(_owner, pthread_self())) clear(INTERRUPTED);
+  clear(INTERRUPTED);
 
   pthread_mutex_unlock(&_waitLock);
 
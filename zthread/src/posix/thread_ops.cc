@@ -26,10 +26,13 @@
 
 #include "thread_ops.h"
 #include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "zthread/guard.h"
 #include "zthread/runnable.h"
 
-#if defined(HAVE_SCHED_YIELD)
+#if defined(HAVE_SCHED_YIELD) || defined(__linux__)
 #include <sched.h>
 #endif
 
@@ -114,6 +117,140 @@ bool ThreadOps::getPriority(ThreadOps* impl, Priority& p) {
   return result;
 }
 
+bool ThreadOps::setName(ThreadOps* impl, const char* name) {
+  assert(impl);
+  assert(name);
+
+  bool result = false;
+
+#if defined(__linux__)
+
+  // Linux limits names to 16 characters, including the terminator, and
+  // rejects longer names rather than truncating them
+  char buf[16];
+
+  strncpy(buf, name, sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\0';
+
+  result = pthread_setname_np(impl->_tid, buf) == 0;
+
+#endif
+
+  return result;
+}
+
+bool ThreadOps::getName(char* name, size_t len) {
+  assert(name);
+
+  bool result = false;
+
+#if defined(__linux__)
+
+  result = pthread_getname_np(pthread_self(), name, len) == 0;
+
+#endif
+
+  return result;
+}
+
+bool ThreadOps::getCpuTime(ThreadOps* impl, unsigned long long& usec) {
+  assert(impl);
+
+  bool result = false;
+
+#if defined(_POSIX_THREAD_CPUTIME) && (_POSIX_THREAD_CPUTIME >= 0)
+
+  clockid_t clock;
+  struct timespec ts;
+
+  if ((result = (pthread_getcpuclockid(impl->_tid, &clock) == 0 &&
+                 clock_gettime(clock, &ts) == 0)))
+    usec = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+
+#endif
+
+  return result;
+}
+
+#if defined(__linux__)
+
+/**
+ * Get the processors the process may run on. The mask of the process' main
+ * thread stands for the process, since the calling thread may be one a
+ * ShardedExecutor left pinned before it was reused.
+ */
+static bool allowed(cpu_set_t& set) {
+  CPU_ZERO(&set);
+
+  return sched_getaffinity(getpid(), sizeof(set), &set) == 0 ||
+         sched_getaffinity(0, sizeof(set), &set) == 0;
+}
+
+#endif
+
+bool ThreadOps::setAffinity(size_t n) {
+  bool result = false;
+
+#if defined(__linux__)
+
+  cpu_set_t set;
+
+  if (allowed(set)) {
+    // Find the n-th processor in the set
+    size_t cpu = 0;
+    for (; cpu < CPU_SETSIZE; ++cpu)
+      if (CPU_ISSET(cpu, &set) && n-- == 0) break;
+
+    if (cpu < CPU_SETSIZE) {
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+
+      result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    }
+  }
+
+#endif
+
+  return result;
+}
+
+bool ThreadOps::clearAffinity() {
+  bool result = false;
+
+#if defined(__linux__)
+
+  cpu_set_t set;
+
+  if (allowed(set))
+    result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+
+#endif
+
+  return result;
+}
+
+size_t ThreadOps::processors() {
+#if defined(__linux__) && defined(CPU_COUNT)
+
+  cpu_set_t set;
+
+  if (allowed(set)) {
+    int n = CPU_COUNT(&set);
+    if (n > 0) return (size_t)n;
+  }
+
+#endif
+
+#if defined(_SC_NPROCESSORS_ONLN)
+
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 0) return (size_t)n;
+
+#endif
+
+  return 1;
+}
+
 bool ThreadOps::spawn(Runnable* task) {
   return pthread_create(&_tid, 0, _dispatch, task) == 0;
 }
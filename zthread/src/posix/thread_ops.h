@@ -126,6 +126,59 @@ class ThreadOps {
    */
   static bool getPriority(ThreadOps*, Priority&);
 
+  /**
+   * Set the name reported for the native thread, if supported by the
+   * system. Names longer than the system allows are truncated.
+   *
+   * @param const char* name
+   * @return bool false if unsuccessful
+   */
+  static bool setName(ThreadOps*, const char*);
+
+  /**
+   * Get the name reported for the currently executing native thread,
+   * if supported by the system.
+   *
+   * @param char* buffer receiving the name
+   * @param size_t size of the buffer
+   * @return bool false if unsuccessful
+   */
+  static bool getName(char*, size_t);
+
+  /**
+   * Get the CPU time consumed by the native thread, if supported by the
+   * system.
+   *
+   * @param unsigned long long& CPU time, in microseconds
+   * @return bool false if unsuccessful
+   */
+  static bool getCpuTime(ThreadOps*, unsigned long long&);
+
+  /**
+   * Pin the currently executing native thread to one of the processors the
+   * process may run on, if supported by the system.
+   *
+   * @param size_t processor, counted from 0 among those the process may
+   *        run on; less than processors()
+   * @return bool false if unsuccessful
+   */
+  static bool setAffinity(size_t);
+
+  /**
+   * Let the currently executing native thread run on any of the processors
+   * the process may run on again, if supported by the system.
+   *
+   * @return bool false if unsuccessful
+   */
+  static bool clearAffinity();
+
+  /**
+   * Get the number of processors the process may run on.
+   *
+   * @return size_t number of processors, 1 if it can't be determined
+   */
+  static size_t processors();
+
  protected:
   /**
    * Spawn a native thread.
@@ -0,0 +1,781 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/scheduled_executor.h"
+#include "zthread/atomic_count.h"
+#include "zthread/condition.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+#include "zthread/time.h"
+
+#include "atomic_ops.h"
+#include "thread_impl.h"
+#include "thread_queue.h"
+#include "waiter_queue.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#if defined(ZT_WIN32) || defined(ZT_WIN9X)
+#include <windows.h>
+#endif
+
+namespace zthread {
+
+namespace {
+
+/**
+ * Milliseconds on a clock that does not follow changes to the time of day,
+ * where the platform provides one.
+ */
+unsigned long monotonic() {
+#if defined(CLOCK_MONOTONIC)
+
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000UL + ts.tv_nsec / 1000000;
+
+#elif defined(ZT_WIN32) || defined(ZT_WIN9X)
+
+  return GetTickCount();
+
+#else
+
+  Time t;
+  return t.seconds() * 1000 + t.milliseconds();
+
+#endif
+}
+
+//! Number the executors so their threads can be told apart
+size_t nextTimerId() {
+  static volatile size_t count = 0;
+  return atomic::add(&count, (size_t)1);
+}
+
+//! Links a TimerEvent into a slot of the wheel, or the dispatched list
+struct Link {
+  Link* prev;
+  Link* next;
+
+  Link() : prev(this), next(this) {}
+
+  bool empty() const { return next == this; }
+
+  void push_back(Link* l) {
+    l->prev = prev;
+    l->next = this;
+    prev->next = l;
+    prev = l;
+  }
+
+  void unlink() {
+    prev->next = next;
+    next->prev = prev;
+    prev = next = this;
+  }
+
+  //! Move every link to the given list, leaving this one empty
+  void splice(Link& to) {
+    if (empty()) return;
+
+    to.prev->next = next;
+    next->prev = to.prev;
+    prev->next = &to;
+    to.prev = prev;
+
+    prev = next = this;
+  }
+};
+}
+
+/**
+ * @class TimerEvent
+ *
+ * A scheduled task. While it is scheduled, dispatched or running, the
+ * event is on one of the executor's lists and holds a reference to itself,
+ * so it stays alive until it completes or is canceled, whether or not a
+ * ScheduledTask still refers to it.
+ *
+ * The event does not keep its executor alive while it waits in the wheel,
+ * that would be a cycle only cancel() could break. It holds a reference
+ * only from the time it is dispatched until its run is over.
+ */
+class TimerEvent : public Runnable, public Link {
+ public:
+  typedef enum { SCHEDULED, DISPATCHED, RUNNING, DONE, CANCELED } State;
+
+  ScheduledExecutorImpl* owner;
+  Task task;
+
+  //! Reference held while the event is on one of the executor's lists
+  CountedPtr<Runnable, AtomicCount> self;
+
+  //! Reference to the executor held while the event is dispatched
+  CountedPtr<ScheduledExecutorImpl> pin;
+
+  //! Thread running the event, if any
+  ThreadImpl* thread;
+
+  //! Dispatches made by the executor before this one
+  size_t sequence;
+
+  //! Tick the event is due at, and the period of a periodic event
+  unsigned long deadline;
+  unsigned long period;
+
+  bool fixedRate;
+  State state;
+
+  TimerEvent(ScheduledExecutorImpl* impl, const Task& t, unsigned long p,
+             bool rate)
+      : owner(impl),
+        task(t),
+        thread(0),
+        sequence(0),
+        deadline(0),
+        period(p),
+        fixedRate(rate),
+        state(SCHEDULED) {}
+
+  void run();
+};
+
+/**
+ * @class ScheduledExecutorImpl
+ *
+ * A hierarchical timing wheel, as described by Varghese and Lauck. Each of
+ * the four levels has 256 slots; a slot of the first level spans a single
+ * tick (millisecond), and a slot of each following level spans a whole
+ * turn of the level below. An event is placed on the lowest level whose
+ * range covers its deadline, and is moved down a level each time the wheel
+ * below completes a turn, until it reaches the first level and expires.
+ *
+ * Events that are due are moved to the dispatched list and submitted to the
+ * executor; they run through TimerEvent::run().
+ */
+class ScheduledExecutorImpl {
+  enum { LEVELS = 4, BITS = 8, SLOTS = 1 << BITS, MASK = SLOTS - 1 };
+
+  typedef std::vector<Task> EventList;
+
+  FastMutex _lock;
+
+  //! Signaled to wake the driver early
+  Condition _changed;
+
+  //! Signaled once no events remain
+  Condition _idle;
+
+  Executor& _executor;
+
+  Link _wheel[LEVELS][SLOTS];
+
+  //! Events submitted to the executor that have not completed
+  Link _dispatched;
+
+  //! Clock reading the ticks count from
+  unsigned long _start;
+
+  //! Next tick to be processed
+  unsigned long _current;
+
+  //! Events in the wheel, and events that have not completed
+  size_t _scheduled;
+  size_t _active;
+
+  //! Set while the driver sleeps until the tick _wakeAt, or indefinitely
+  bool _sleeping;
+  bool _forever;
+  unsigned long _wakeAt;
+
+  bool _canceled;
+
+  //! Events dispatched so far
+  size_t _dispatches;
+
+  //! Events dispatched before this count are interrupted
+  size_t _interrupt;
+
+  //! Identifies this executor in the name of its thread
+  size_t _id;
+
+  //! Ticks elapsed since the executor was created
+  unsigned long now() { return monotonic() - _start; }
+
+  //! Test whether tick a comes before tick b, tolerating wrap around
+  static bool before(unsigned long a, unsigned long b) {
+    return (long)(a - b) < 0;
+  }
+
+  /**
+   * Place an event in the slot that covers its deadline.
+   *
+   * @pre the lock is held
+   */
+  void insert(TimerEvent* e) {
+    unsigned long expires = e->deadline;
+    unsigned long delta = expires - _current;
+
+    Link* slot;
+
+    if (before(expires, _current))
+      // Already due, it expires with the next tick processed
+      slot = &_wheel[0][_current & MASK];
+    else if (delta < (1UL << BITS))
+      slot = &_wheel[0][expires & MASK];
+    else if (delta < (1UL << 2 * BITS))
+      slot = &_wheel[1][(expires >> BITS) & MASK];
+    else if (delta < (1UL << 3 * BITS))
+      slot = &_wheel[2][(expires >> 2 * BITS) & MASK];
+    else {
+      // Beyond the range of the wheel, it is placed again as it cascades
+      if (delta > 0xffffffffUL) expires = _current + 0xffffffffUL;
+
+      slot = &_wheel[3][(expires >> 3 * BITS) & MASK];
+    }
+
+    slot->push_back(e);
+  }
+
+  /**
+   * Move the events of a slot down to the levels below.
+   *
+   * @pre the lock is held
+   */
+  void cascade(size_t level, size_t index) {
+    Link list;
+    _wheel[level][index].splice(list);
+
+    while (!list.empty()) {
+      TimerEvent* e = static_cast<TimerEvent*>(list.next);
+
+      list.next->unlink();
+      insert(e);
+    }
+  }
+
+  /**
+   * Process every tick up to and including the given one, collecting the
+   * events that expire.
+   *
+   * @pre the lock is held
+   */
+  void advance(unsigned long tick, EventList& due,
+               const CountedPtr<ScheduledExecutorImpl>& self) {
+    while (!before(tick, _current)) {
+      // Nothing to process, skip ahead
+      if (_scheduled == 0) {
+        _current = tick + 1;
+        break;
+      }
+
+      size_t index = _current & MASK;
+
+      // The first level completed a turn, bring down the events of the
+      // next slot of the levels above
+      for (size_t level = 1; index == 0 && level < LEVELS; ++level) {
+        size_t i = (_current >> level * BITS) & MASK;
+        cascade(level, i);
+
+        if (i != 0) break;
+      }
+
+      Link& slot = _wheel[0][index];
+
+      while (!slot.empty()) {
+        TimerEvent* e = static_cast<TimerEvent*>(slot.next);
+
+        slot.next->unlink();
+        _dispatched.push_back(e);
+
+        e->state = TimerEvent::DISPATCHED;
+        e->sequence = _dispatches++;
+        e->pin = self;
+
+        due.push_back(Task(e->self));
+
+        --_scheduled;
+      }
+
+      ++_current;
+    }
+  }
+
+  /**
+   * Find the next tick worth processing: the first occupied slot of the
+   * first level or, failing that, the start of its next turn, when the
+   * levels above cascade.
+   *
+   * @pre the lock is held
+   * @return bool false if there are no events in the wheel
+   */
+  bool next(unsigned long& tick) {
+    if (_scheduled == 0) return false;
+
+    tick = _current;
+
+    // A new turn is about to begin
+    if ((tick & MASK) == 0) return true;
+
+    while (_wheel[0][tick & MASK].empty())
+      if ((++tick & MASK) == 0) break;
+
+    return true;
+  }
+
+  //! Wake the driver if it would sleep past the given tick
+  void wake(unsigned long tick) {
+    if (_sleeping && (_forever || before(tick, _wakeAt))) _changed.Signal();
+  }
+
+  /**
+   * Remove a completed or canceled event.
+   *
+   * @pre the lock is held
+   */
+  void retire(TimerEvent* e, TimerEvent::State state,
+              CountedPtr<Runnable, AtomicCount>& released) {
+    e->unlink();
+    e->state = state;
+
+    released.swap(e->self);
+
+    if (--_active == 0) _idle.Broadcast();
+  }
+
+ public:
+  ScheduledExecutorImpl(Executor& executor)
+      : _changed(_lock),
+        _idle(_lock),
+        _executor(executor),
+        _start(monotonic()),
+        _current(0),
+        _scheduled(0),
+        _active(0),
+        _sleeping(false),
+        _forever(false),
+        _wakeAt(0),
+        _canceled(false),
+        _dispatches(0),
+        _interrupt(0),
+        _id(nextTimerId()) {}
+
+  //! Schedule an event, the first time
+  void schedule(CountedPtr<TimerEvent, AtomicCount>& event,
+                unsigned long delay) {
+    TimerEvent* e = &*event;
+
+    // Keep the deadline within half the range of the clock
+    if (delay > (~0UL >> 1)) delay = ~0UL >> 1;
+
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) throw CancellationException();
+
+    e->self = event;
+    e->deadline = now() + delay;
+
+    insert(e);
+
+    ++_scheduled;
+    ++_active;
+
+    wake(e->deadline);
+  }
+
+  //! Run an event that was dispatched to the executor
+  void fire(TimerEvent* e) {
+    // Dropped once the lock is released, it may be the last reference to
+    // this executor
+    CountedPtr<ScheduledExecutorImpl> pin;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      if (e->state != TimerEvent::DISPATCHED) {
+        pin.swap(e->pin);
+        return;
+      }
+
+      e->state = TimerEvent::RUNNING;
+
+      // Interrupt the event if it was dispatched before interrupt() was
+      // called, otherwise give it a clean slate
+      ThreadImpl* impl = ThreadImpl::current();
+
+      if (e->sequence < _interrupt)
+        impl->interrupt();
+      else
+        impl->isInterrupted();
+
+      e->thread = impl;
+    }
+
+    try {
+      e->task->run();
+    } catch (...) {
+      /* consume the exceptions the work propogates */
+    }
+
+    CountedPtr<Runnable, AtomicCount> released;
+    Guard<FastMutex> g(_lock);
+
+    e->thread = 0;
+    pin.swap(e->pin);
+
+    // Canceled while it was running
+    if (e->state != TimerEvent::RUNNING) return;
+
+    if (e->period == 0) {
+      retire(e, TimerEvent::DONE, released);
+      return;
+    }
+
+    e->unlink();
+    e->state = TimerEvent::SCHEDULED;
+
+    if (e->fixedRate)
+      e->deadline += e->period;
+    else
+      e->deadline = now() + e->period;
+
+    insert(e);
+    ++_scheduled;
+
+    wake(e->deadline);
+  }
+
+  //! Cancel a single event
+  bool cancel(TimerEvent* e) {
+    CountedPtr<Runnable, AtomicCount> released;
+    Guard<FastMutex> g(_lock);
+
+    switch (e->state) {
+      case TimerEvent::SCHEDULED:
+        --_scheduled;
+        break;
+
+      case TimerEvent::DISPATCHED:
+        break;
+
+      case TimerEvent::RUNNING:
+        // Only a periodic event can be stopped from running again
+        if (e->period == 0) return false;
+        break;
+
+      default:
+        return false;
+    }
+
+    retire(e, TimerEvent::CANCELED, released);
+    return true;
+  }
+
+  //! An event the executor would not accept
+  void reject(TimerEvent* e) {
+    CountedPtr<ScheduledExecutorImpl> pin;
+    CountedPtr<Runnable, AtomicCount> released;
+    Guard<FastMutex> g(_lock);
+
+    pin.swap(e->pin);
+
+    if (e->state == TimerEvent::DISPATCHED)
+      retire(e, TimerEvent::CANCELED, released);
+  }
+
+  bool isCanceled(TimerEvent* e) {
+    Guard<FastMutex> g(_lock);
+    return e->state == TimerEvent::CANCELED;
+  }
+
+  bool isDone(TimerEvent* e) {
+    Guard<FastMutex> g(_lock);
+    return e->state == TimerEvent::DONE;
+  }
+
+  //! Advance the wheel and dispatch the events that are due, until canceled
+  void drive(const CountedPtr<ScheduledExecutorImpl>& self) {
+    char name[32];
+    sprintf(name, "timer-%lu", (unsigned long)_id);
+
+    ThreadImpl::current()->setName(name);
+
+    EventList due;
+
+    for (;;) {
+      {
+        Guard<FastMutex> g(_lock);
+
+        for (;;) {
+          if (_canceled) return;
+
+          advance(now(), due, self);
+          if (!due.empty()) break;
+
+          unsigned long tick = 0;
+          _forever = !next(tick);
+
+          _sleeping = true;
+          _wakeAt = tick;
+
+          try {
+            if (_forever)
+              _changed.Wait();
+            else if (before(now(), tick))
+              _changed.Wait(tick - now());
+
+          } catch (InterruptedException&) {
+            // Only an early wake, the wheel is checked again anyway
+          }
+
+          _sleeping = false;
+        }
+      }
+
+      // Submit the whole tick at once, outside the lock
+      try {
+        _executor.ExecuteAll(&due[0], &due[0] + due.size());
+      } catch (...) {
+        for (EventList::iterator i = due.begin(); i != due.end(); ++i)
+          reject(static_cast<TimerEvent*>(&**i));
+      }
+
+      due.clear();
+    }
+  }
+
+  size_t size() {
+    Guard<FastMutex> g(_lock);
+    return _active;
+  }
+
+  //! Interrupt the events that are running, or dispatched and waiting to
+  void interrupt() {
+    Guard<FastMutex> g(_lock);
+
+    _interrupt = _dispatches;
+
+    for (Link* l = _dispatched.next; l != &_dispatched; l = l->next) {
+      TimerEvent* e = static_cast<TimerEvent*>(l);
+      if (e->thread) e->thread->interrupt();
+    }
+  }
+
+  //! Cancel every event and stop accepting new ones
+  void cancel() {
+    std::vector<CountedPtr<Runnable, AtomicCount> > released;
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) return;
+    _canceled = true;
+
+    Link list;
+
+    for (size_t level = 0; level < LEVELS; ++level)
+      for (size_t i = 0; i < SLOTS; ++i) _wheel[level][i].splice(list);
+
+    _dispatched.splice(list);
+
+    while (!list.empty()) {
+      TimerEvent* e = static_cast<TimerEvent*>(list.next);
+
+      list.next->unlink();
+      e->state = TimerEvent::CANCELED;
+
+      released.push_back(CountedPtr<Runnable, AtomicCount>());
+      released.back().swap(e->self);
+    }
+
+    _scheduled = 0;
+    _active = 0;
+
+    _idle.Broadcast();
+    _changed.Signal();
+  }
+
+  bool isCanceled() {
+    Guard<FastMutex> g(_lock);
+    return _canceled;
+  }
+
+  bool wait(unsigned long timeout) {
+    Guard<FastMutex> g(_lock);
+    Time start;
+
+    while (_active > 0) {
+      if (timeout == 0) {
+        _idle.Wait();
+        continue;
+      }
+
+      unsigned long ms = WaiterQueue::elapsed(start);
+      if (ms >= timeout || !_idle.Wait(timeout - ms)) return _active == 0;
+    }
+
+    return true;
+  }
+};
+
+void TimerEvent::run() { owner->fire(this); }
+
+namespace {
+
+//! Runs the timing wheel
+class Driver : public Runnable {
+  CountedPtr<ScheduledExecutorImpl> _impl;
+
+ public:
+  Driver(const CountedPtr<ScheduledExecutorImpl>& impl) : _impl(impl) {}
+
+  void run() { _impl->drive(_impl); }
+};
+
+//! Helper
+class Shutdown : public Runnable {
+  CountedPtr<ScheduledExecutorImpl> _impl;
+
+ public:
+  Shutdown(const CountedPtr<ScheduledExecutorImpl>& impl) : _impl(impl) {}
+
+  void run() { _impl->cancel(); }
+};
+
+TimerEvent* event(CountedPtr<Runnable, AtomicCount>& ptr) {
+  return static_cast<TimerEvent*>(&*ptr);
+}
+}
+
+ScheduledTask::ScheduledTask(const CountedPtr<ScheduledExecutorImpl>& owner,
+                             const CountedPtr<Runnable, AtomicCount>& event)
+    : _owner(owner), _event(event) {}
+
+ScheduledTask::ScheduledTask() {}
+
+ScheduledTask::ScheduledTask(const ScheduledTask& task)
+    : _owner(task._owner), _event(task._event) {}
+
+ScheduledTask::~ScheduledTask() {}
+
+ScheduledTask& ScheduledTask::operator=(const ScheduledTask& task) {
+  _owner = task._owner;
+  _event = task._event;
+
+  return *this;
+}
+
+bool ScheduledTask::Cancel() {
+  if (!_event) return false;
+
+  return _owner->cancel(event(_event));
+}
+
+bool ScheduledTask::IsCanceled() {
+  if (!_event) return false;
+
+  return _owner->isCanceled(event(_event));
+}
+
+bool ScheduledTask::IsDone() {
+  if (!_event) return false;
+
+  return _owner->isDone(event(_event));
+}
+
+ScheduledExecutor::ScheduledExecutor(Executor& executor)
+    : _impl(new ScheduledExecutorImpl(executor)),
+      _shutdown(new Shutdown(_impl)) {
+  Thread t(new Driver(_impl));
+
+  // Request cancelation when main() exits
+  ThreadQueue::instance()->insertShutdownTask(_shutdown);
+}
+
+ScheduledExecutor::~ScheduledExecutor() {
+  try {
+    /**
+     * If the shutdown task for this executor has not already been
+     * selected to run, then run it locally
+     */
+    if (ThreadQueue::instance()->removeShutdownTask(_shutdown))
+      _shutdown->run();
+
+  } catch (...) {
+  }
+}
+
+ScheduledTask ScheduledExecutor::Schedule(const Task& task,
+                                          unsigned long delay) {
+  CountedPtr<TimerEvent, AtomicCount> e(
+      new TimerEvent(&*_impl, task, 0, false));
+  _impl->schedule(e, delay);
+
+  return ScheduledTask(_impl, e);
+}
+
+ScheduledTask ScheduledExecutor::ScheduleAtFixedRate(const Task& task,
+                                                     unsigned long delay,
+                                                     unsigned long period) {
+  if (period == 0) throw InvalidOpException();
+
+  CountedPtr<TimerEvent, AtomicCount> e(
+      new TimerEvent(&*_impl, task, period, true));
+  _impl->schedule(e, delay);
+
+  return ScheduledTask(_impl, e);
+}
+
+ScheduledTask ScheduledExecutor::ScheduleWithFixedDelay(const Task& task,
+                                                        unsigned long delay,
+                                                        unsigned long period) {
+  if (period == 0) throw InvalidOpException();
+
+  CountedPtr<TimerEvent, AtomicCount> e(
+      new TimerEvent(&*_impl, task, period, false));
+  _impl->schedule(e, delay);
+
+  return ScheduledTask(_impl, e);
+}
+
+void ScheduledExecutor::Execute(const Task& task) { Schedule(task, 0); }
+
+void ScheduledExecutor::Interrupt() { _impl->interrupt(); }
+
+size_t ScheduledExecutor::size() { return _impl->size(); }
+
+void ScheduledExecutor::Cancel() { _impl->cancel(); }
+
+bool ScheduledExecutor::IsCanceled() { return _impl->isCanceled(); }
+
+void ScheduledExecutor::Wait() { _impl->wait(0); }
+
+bool ScheduledExecutor::Wait(unsigned long timeout) {
+  return _impl->wait(timeout == 0 ? 1 : timeout);
+}
+
+}  // namespace zthread
@@ -84,6 +84,27 @@ class priority_list : public std::deque<ThreadImpl*> {
   }
 };
 
+/**
+ * @class recency_list
+ *
+ * Queues waiters first in, first out, or most recent first while the flag
+ * it was created with is set. The flag may change while the list is in use,
+ * it only decides where the next waiter goes.
+ */
+class recency_list : public std::deque<ThreadImpl*> {
+  const volatile bool* _lifo;
+
+ public:
+  recency_list(const volatile bool* lifo = 0) : _lifo(lifo) {}
+
+  void insert(const value_type& val) {
+    if (_lifo && *_lifo)
+      push_front(val);
+    else
+      push_back(val);
+  }
+};
+
 }  // namespace ZThread
 
 #endif  // __ZTSCHEDULING_H__
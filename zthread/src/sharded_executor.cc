@@ -0,0 +1,514 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/sharded_executor.h"
+#include "zthread/atomic_count.h"
+#include "zthread/condition.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+#include "zthread/time.h"
+
+#include "atomic_ops.h"
+#include "spsc_queue.h"
+#include "thread_impl.h"
+#include "thread_queue.h"
+#include "tss.h"
+#include "waiter_queue.h"
+
+#include <stdio.h>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace zthread {
+
+namespace {
+
+//! Tasks a shard runs between looks at its mailboxes
+const size_t ShardBatch = 32;
+
+//! Number the executors so their threads can be told apart
+size_t nextExecutorId() {
+  static volatile size_t count = 0;
+  return atomic::add(&count, (size_t)1);
+}
+
+//! A task, with the WaiterQueue slot and the generation it was counted in
+struct Entry {
+  Task task;
+  size_t group;
+  size_t generation;
+
+  Entry()
+      : task(CountedPtr<Runnable, AtomicCount>()), group(0), generation(0) {}
+
+  Entry(const Task& t, const std::pair<size_t, size_t>& pr)
+      : task(t), group(pr.first), generation(pr.second) {}
+};
+
+typedef SpscQueue<Entry> Mailbox;
+
+/**
+ * @class Shard
+ *
+ * The run queue and mailboxes of one shard. Only the shard's own thread
+ * touches the run queue; each mailbox has the shard as its consumer and one
+ * other shard as its producer. The lock guards the inbox, the parking of
+ * the shard's thread and the reference to it.
+ */
+struct Shard {
+  ShardedExecutorImpl* owner;
+  size_t index;
+
+  //! Tasks ready to run
+  std::deque<Entry> local;
+
+  //! Mailbox from each other shard, created by that shard when it first
+  //! submits a task here
+  std::vector<Mailbox*> mail;
+
+  FastMutex lock;
+  Condition wakeup;
+
+  //! Tasks submitted from threads outside the executor
+  std::deque<Entry> inbox;
+  volatile size_t inboxed;
+
+  //! Set while the shard's thread is parked, or about to park
+  volatile bool parked;
+
+  //! Thread serving the shard, while it runs
+  ThreadImpl* thread;
+
+  //! Tasks of this shard not yet completed
+  WaiterQueue tasks;
+
+  Shard(ShardedExecutorImpl* o, size_t i, size_t n)
+      : owner(o),
+        index(i),
+        mail(n, (Mailbox*)0),
+        wakeup(lock),
+        inboxed(0),
+        parked(false),
+        thread(0) {}
+
+  ~Shard() {
+    for (size_t i = 0; i < mail.size(); ++i) delete mail[i];
+  }
+
+  //! Test for tasks waiting in the mailboxes or the inbox
+  //! @pre the lock is held
+  bool pending() {
+    if (!inbox.empty()) return true;
+
+    for (size_t i = 0; i < mail.size(); ++i) {
+      Mailbox* box = atomic::load(&mail[i]);
+      if (box && !box->empty()) return true;
+    }
+
+    return false;
+  }
+
+  //! Move the tasks waiting in the mailboxes and the inbox to the run queue
+  void collect() {
+    Entry e;
+
+    for (size_t i = 0; i < mail.size(); ++i) {
+      Mailbox* box = atomic::load(&mail[i]);
+      if (box)
+        while (box->next(e)) local.push_back(e);
+    }
+
+    if (atomic::load(&inboxed) == 0) return;
+
+    Guard<FastMutex> g(lock);
+
+    local.insert(local.end(), inbox.begin(), inbox.end());
+    inbox.clear();
+
+    atomic::store(&inboxed, (size_t)0);
+  }
+};
+}
+
+//! Synchronization point for the ShardedExecutor
+class ShardedExecutorImpl {
+  std::vector<Shard*> _shards;
+
+  volatile bool _canceled;
+
+  //! Shard the next task submitted from outside the executor goes to
+  volatile size_t _turn;
+
+  //! Identifies this executor in the names of its threads
+  size_t _id;
+
+  //! Pin each shard's thread to a processor
+  bool _pin;
+
+  //! The shard served by the current thread, if any
+  static TSS<Shard*>& current() {
+    static TSS<Shard*> shard;
+    return shard;
+  }
+
+  //! Wake the shard's thread if it is parked
+  void wake(Shard* shard) {
+    // Order the add before reading the flag; the shard raises it before
+    // it looks at its mailboxes a final time
+    atomic::fence();
+
+    if (atomic::load(&shard->parked)) {
+      Guard<FastMutex> g(shard->lock);
+      shard->wakeup.Signal();
+    }
+  }
+
+  /**
+   * Park the current shard's thread until a task arrives.
+   *
+   * @return bool false if the executor is canceled and the shard has no
+   *         tasks left, the thread should exit
+   */
+  bool park(Shard* self) {
+    Guard<FastMutex> g(self->lock);
+
+    atomic::store(&self->parked, true);
+    atomic::fence();
+
+    if (!self->pending()) {
+      // A task counted before the executor was canceled is on its way
+      if (atomic::load(&_canceled) && self->tasks.pending() == 0) {
+        atomic::store(&self->parked, false);
+        return false;
+      }
+
+      // Interruption is ignored here, the executor interrupts its threads
+      // only in the hope that they are running a task
+      try {
+        self->wakeup.Wait();
+      } catch (InterruptedException&) {
+      }
+    }
+
+    atomic::store(&self->parked, false);
+    return true;
+  }
+
+  //! Run the task at the front of the current shard's run queue
+  void run(Shard* self) {
+    Entry e(self->local.front());
+    self->local.pop_front();
+
+    // Interrupt the tasks submitted before the executor was interrupted,
+    // give the others a clean slate
+    if (e.generation != self->tasks.generation())
+      ThreadImpl::current()->interrupt();
+    else
+      ThreadImpl::current()->isInterrupted();
+
+    try {
+      e.task->run();
+    } catch (...) {
+      /* consume the exceptions the work propogates */
+    }
+
+    self->tasks.decrement(e.group);
+  }
+
+ public:
+  ShardedExecutorImpl(size_t n, bool pin)
+      : _canceled(false), _turn(0), _id(nextExecutorId()), _pin(pin) {
+    _shards.reserve(n);
+
+    try {
+      for (size_t i = 0; i < n; ++i)
+        _shards.push_back(new Shard(this, i, n));
+
+    } catch (...) {
+      for (size_t i = 0; i < _shards.size(); ++i) delete _shards[i];
+      throw;
+    }
+  }
+
+  ~ShardedExecutorImpl() {
+    for (size_t i = 0; i < _shards.size(); ++i) delete _shards[i];
+  }
+
+  size_t size() { return _shards.size(); }
+
+  //! The shard the current thread serves, 0 if it serves none
+  Shard* local() {
+    Shard* shard = current().get();
+    return (shard && shard->owner == this) ? shard : 0;
+  }
+
+  size_t index() {
+    Shard* shard = local();
+    return shard ? shard->index : _shards.size();
+  }
+
+  void submitLocal(const Task& task) {
+    Shard* self = local();
+
+    if (!self) throw InvalidOpException();
+    if (atomic::load(&_canceled)) throw CancellationException();
+
+    std::pair<size_t, size_t> pr(self->tasks.increment());
+
+    try {
+      self->local.push_back(Entry(task, pr));
+    } catch (...) {
+      self->tasks.decrement(pr.first);
+      throw;
+    }
+  }
+
+  void submit(size_t index, const Task& task) {
+    if (index >= _shards.size()) throw InvalidOpException();
+
+    Shard* to = _shards[index];
+    Shard* from = local();
+
+    if (from == to) {
+      submitLocal(task);
+      return;
+    }
+
+    if (atomic::load(&_canceled)) throw CancellationException();
+
+    std::pair<size_t, size_t> pr(to->tasks.increment());
+
+    // Look again, a canceled shard exits once none of its tasks is pending
+    atomic::fence();
+
+    try {
+      if (atomic::load(&_canceled)) throw CancellationException();
+
+      if (from) {
+        Mailbox* box = to->mail[from->index];
+
+        // Only this shard writes the slot, the consumer only reads it
+        if (!box) {
+          box = new Mailbox;
+          atomic::store(&to->mail[from->index], box);
+        }
+
+        box->add(Entry(task, pr));
+
+      } else {
+        Guard<FastMutex> g(to->lock);
+
+        to->inbox.push_back(Entry(task, pr));
+        atomic::store(&to->inboxed, to->inbox.size());
+      }
+
+    } catch (...) {
+      to->tasks.decrement(pr.first);
+      throw;
+    }
+
+    wake(to);
+  }
+
+  void execute(const Task& task) {
+    if (local())
+      submitLocal(task);
+    else
+      submit(atomic::add(&_turn, (size_t)1) % _shards.size(), task);
+  }
+
+  //! Serve a shard, on its own thread
+  void serve(size_t index) {
+    Shard* self = _shards[index];
+    ThreadImpl* impl = ThreadImpl::current();
+
+    current().set(self);
+
+    // Pinning is only a preference, a shard runs just as well unpinned.
+    // Processors are counted within those the process may run on
+    if (_pin) ThreadOps::setAffinity(index % ThreadOps::processors());
+
+    // Name the thread after its executor, e.g. shard-2-s5
+    char name[32];
+    sprintf(name, "shard-%lu-s%lu", (unsigned long)_id, (unsigned long)index);
+
+    impl->setName(name);
+
+    {
+      Guard<FastMutex> g(self->lock);
+      self->thread = impl;
+    }
+
+    for (;;) {
+      self->collect();
+
+      if (self->local.empty()) {
+        if (!park(self)) break;
+        continue;
+      }
+
+      for (size_t n = 0; n < ShardBatch && !self->local.empty(); ++n)
+        run(self);
+    }
+
+    {
+      Guard<FastMutex> g(self->lock);
+      self->thread = 0;
+    }
+
+    // The thread may be reused for other work once it leaves
+    if (_pin) ThreadOps::clearAffinity();
+
+    current().set(0);
+  }
+
+  void interrupt() {
+    for (size_t i = 0; i < _shards.size(); ++i) {
+      Shard* shard = _shards[i];
+
+      // Bump the generation up first, so the tasks already queued get this
+      // interrupt as well
+      shard->tasks.generation(true);
+
+      Guard<FastMutex> g(shard->lock);
+      if (shard->thread) shard->thread->interrupt();
+    }
+  }
+
+  void cancel() {
+    atomic::exchange(&_canceled, true);
+
+    // Parked shards with nothing left to run exit
+    for (size_t i = 0; i < _shards.size(); ++i) {
+      Guard<FastMutex> g(_shards[i]->lock);
+      _shards[i]->wakeup.Signal();
+    }
+  }
+
+  bool isCanceled() { return atomic::load(&_canceled); }
+
+  bool wait(unsigned long timeout) {
+    Time start;
+
+    for (size_t i = 0; i < _shards.size(); ++i) {
+      if (timeout == 0) {
+        _shards[i]->tasks.wait(0);
+        continue;
+      }
+
+      unsigned long ms = WaiterQueue::elapsed(start);
+      if (ms >= timeout || !_shards[i]->tasks.wait(timeout - ms)) return false;
+    }
+
+    return true;
+  }
+
+}; /* ShardedExecutorImpl */
+
+namespace {
+
+//! Serves one shard
+class ShardWorker : public Runnable {
+  CountedPtr<ShardedExecutorImpl> _impl;
+  size_t _index;
+
+ public:
+  ShardWorker(const CountedPtr<ShardedExecutorImpl>& impl, size_t index)
+      : _impl(impl), _index(index) {}
+
+  void run() { _impl->serve(_index); }
+};
+
+//! Cancels the executor when main() exits
+class Shutdown : public Runnable {
+  CountedPtr<ShardedExecutorImpl> _impl;
+
+ public:
+  Shutdown(const CountedPtr<ShardedExecutorImpl>& impl) : _impl(impl) {}
+
+  void run() { _impl->cancel(); }
+};
+}
+
+ShardedExecutor::ShardedExecutor(size_t shards, bool pin)
+    : _impl(new ShardedExecutorImpl(shards ? shards : ThreadOps::processors(),
+                                    pin)),
+      _shutdown(new Shutdown(_impl)) {
+  try {
+    for (size_t i = 0; i < _impl->size(); ++i)
+      Thread t(new ShardWorker(_impl, i));
+
+  } catch (...) {
+    // The shards that did start exit, no task was accepted yet
+    _impl->cancel();
+    throw;
+  }
+
+  // Request cancelation when main() exits
+  ThreadQueue::instance()->insertShutdownTask(_shutdown);
+}
+
+ShardedExecutor::~ShardedExecutor() {
+  try {
+    /**
+     * If the shutdown task for this executor has not already been
+     * selected to run, then run it locally
+     */
+    if (ThreadQueue::instance()->removeShutdownTask(_shutdown))
+      _shutdown->run();
+
+  } catch (...) {
+  }
+}
+
+size_t ShardedExecutor::size() { return _impl->size(); }
+
+size_t ShardedExecutor::current() { return _impl->index(); }
+
+void ShardedExecutor::SubmitTo(size_t shard, const Task& task) {
+  _impl->submit(shard, task);
+}
+
+void ShardedExecutor::SubmitLocal(const Task& task) {
+  _impl->submitLocal(task);
+}
+
+void ShardedExecutor::Execute(const Task& task) { _impl->execute(task); }
+
+void ShardedExecutor::Interrupt() { _impl->interrupt(); }
+
+void ShardedExecutor::Cancel() { _impl->cancel(); }
+
+bool ShardedExecutor::IsCanceled() { return _impl->isCanceled(); }
+
+void ShardedExecutor::Wait() { _impl->wait(0); }
+
+bool ShardedExecutor::Wait(unsigned long timeout) {
+  return _impl->wait(timeout == 0 ? 1 : timeout);
+}
+
+}  // namespace zthread
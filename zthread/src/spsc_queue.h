@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTSPSCQUEUE_H__
+#define __ZTSPSCQUEUE_H__
+
+#include "atomic_ops.h"
+#include "zthread/non_copyable.h"
+
+#include <stddef.h>
+
+namespace zthread {
+
+/**
+ * @class SpscQueue
+ *
+ * An unbounded FIFO queue between exactly one producer thread and one
+ * consumer thread. Items are kept in fixed size segments linked into a
+ * list. Each side writes only its own position, so add() and next() cost a
+ * plain store and load, with no compare and swap. A segment the consumer
+ * has drained is handed back to the producer for reuse, so a queue whose
+ * backlog stays under a segment allocates nothing once it is warm.
+ *
+ * T must be copyable and default constructible; a slot is reset to T()
+ * once its item has been taken.
+ */
+template <typename T, size_t N = 64>
+class SpscQueue : private NonCopyable {
+  struct Segment {
+    T items[N];
+
+    //! Items the producer has published in this segment
+    volatile size_t written;
+
+    Segment* volatile next;
+
+    Segment() : written(0), next(0) {}
+  };
+
+  // Kept on separate cache lines, the producer only touches the first and
+  // the consumer the second
+  char _pad0[64];
+  Segment* _tail;
+  size_t _write;
+  char _pad1[64];
+  Segment* _head;
+  size_t _read;
+  char _pad2[64];
+
+  //! A drained segment waiting to be reused by the producer
+  Segment* volatile _spare;
+
+ public:
+  SpscQueue() : _write(0), _read(0), _spare(0) { _head = _tail = new Segment; }
+
+  ~SpscQueue() {
+    while (_head) {
+      Segment* s = _head;
+      _head = s->next;
+
+      delete s;
+    }
+
+    delete _spare;
+  }
+
+  //! Add an item to the end of the queue; only called by the producer
+  void add(const T& item) {
+    if (_write == N) {
+      Segment* s = atomic::exchange(&_spare, (Segment*)0);
+
+      if (s) {
+        s->written = 0;
+        s->next = 0;
+      } else
+        s = new Segment;
+
+      atomic::store(&_tail->next, s);
+
+      _tail = s;
+      _write = 0;
+    }
+
+    _tail->items[_write] = item;
+    atomic::store(&_tail->written, ++_write);
+  }
+
+  /**
+   * Remove the item at the front of the queue; only called by the consumer.
+   *
+   * @return bool false if the queue is empty
+   */
+  bool next(T& item) {
+    if (_read == N) {
+      Segment* next = atomic::load(&_head->next);
+      if (!next) return false;
+
+      // The producer has moved on, hand the drained segment back to it
+      Segment* drained = _head;
+
+      _head = next;
+      _read = 0;
+
+      delete atomic::exchange(&_spare, drained);
+    }
+
+    if (_read == atomic::load(&_head->written)) return false;
+
+    item = _head->items[_read];
+    _head->items[_read++] = T();
+
+    return true;
+  }
+
+  //! Test for items; only called by the consumer
+  bool empty() const {
+    return _read == atomic::load(&_head->written) &&
+           (_read < N || atomic::load(&_head->next) == 0);
+  }
+};
+
+}  // namespace zthread
+
+#endif  // __ZTSPSCQUEUE_H__
@@ -31,6 +31,24 @@
 
 namespace zthread {
 
+/**
+ * @class BlockingListener
+ *
+ * Told when the thread owning a Monitor is about to block on it, and when it
+ * resumes. An executor listens to its workers this way, to stand in for
+ * those whose tasks block.
+ */
+class BlockingListener {
+ public:
+  virtual ~BlockingListener() {}
+
+  //! The owning thread is about to block
+  virtual void blocking() = 0;
+
+  //! The owning thread has resumed
+  virtual void unblocked() = 0;
+};
+
 /**
  * @class Status
  * @version 2.3.0
@@ -41,12 +59,16 @@ namespace zthread {
  */
 class Status {
  public:
-  //! Aggregate of pending status changes
+  //! Aggregate of pending status changes. Written only while the owning
+  //! Monitor serializes access, but may be read at any time via snapshot()
   volatile unsigned short _pending;
 
   //! Interest mask
   volatile unsigned short _mask;
 
+  //! Told about each wait() that blocks, 0 if nothing is listening
+  BlockingListener* _listener;
+
  public:
   //! State for the monitor
   typedef enum {
@@ -65,7 +87,14 @@ class Status {
 
   } STATE;
 
-  Status() : _pending(INVALID), _mask(ANYTHING) {}
+  Status() : _pending(INVALID), _mask(ANYTHING), _listener(0) {}
+
+  /**
+   * Set the listener told when the owning thread blocks, or 0 for none.
+   *
+   * @pre accessed ONLY by the owning thread, outside of wait().
+   */
+  void listen(BlockingListener* listener) { _listener = listener; }
 
   /**
    * Set the mask for the STATE's that next() will report.
@@ -78,6 +107,21 @@ class Status {
    */
   void interest(STATE mask) { _mask = static_cast<unsigned short>(mask); }
 
+  /**
+   * Read the pending flags without serializing access. The flags are always
+   * published as a single store, so the result is a consistent (if possibly
+   * stale) view, and anything written before the store is visible after it.
+   *
+   * @return unsigned short the pending flags
+   */
+  unsigned short snapshot() const {
+#if defined(__GNUC__)
+    return __atomic_load_n(&_pending, __ATOMIC_ACQUIRE);
+#else
+    return _pending;
+#endif
+  }
+
   bool masked(STATE mask) {
     return (_mask & static_cast<unsigned short>(mask)) == 0;
   }
@@ -112,7 +156,7 @@ class Status {
    * @param interest - the flags to add to the current state.
    * @pre access must be serial
    */
-  void push(STATE interest) { _pending |= interest; }
+  void push(STATE interest) { publish(_pending | interest); }
 
   /**
    * Clear the flags from the current state
@@ -125,7 +169,7 @@ class Status {
     assert(interest != ANYTHING);
     assert(interest != CANCELED);
 
-    _pending &= ~interest;
+    publish(_pending & ~interest);
   }
 
   /**
@@ -146,21 +190,32 @@ class Status {
     if (((_pending & _mask) & SIGNALED) != 0) {
       // Absorb the timeout if it happens when a signal
       // is available at the same time
-      _pending &= ~(SIGNALED | TIMEDOUT);
+      publish(_pending & ~(SIGNALED | TIMEDOUT));
       state = SIGNALED;
 
     } else if (((_pending & _mask) & TIMEDOUT) != 0) {
-      _pending &= ~TIMEDOUT;
+      publish(_pending & ~TIMEDOUT);
       state = TIMEDOUT;
 
     } else if (((_pending & _mask) & INTERRUPTED) != 0) {
-      _pending &= ~INTERRUPTED;
+      publish(_pending & ~INTERRUPTED);
       state = INTERRUPTED;
     }
 
     assert(state != INVALID);
     return state;
   }
+
+ private:
+  //! Replace the pending flags so that snapshot() observes them whole
+  void publish(unsigned int pending) {
+#if defined(__GNUC__)
+    __atomic_store_n(&_pending, static_cast<unsigned short>(pending),
+                     __ATOMIC_RELEASE);
+#else
+    _pending = static_cast<unsigned short>(pending);
+#endif
+  }
 };
 
 };  // namespace ZThread
@@ -0,0 +1,373 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/strand.h"
+#include "zthread/condition.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+#include "zthread/time.h"
+
+#include "thread_impl.h"
+#include "waiter_queue.h"
+
+#include <deque>
+
+namespace zthread {
+
+namespace {
+
+//! Tasks a Strand runs before giving its thread back to the executor
+const size_t StrandBatch = 32;
+}
+
+//! Queue of a Strand, drained by one thread at a time
+class StrandImpl {
+  Executor& _executor;
+
+  FastMutex _lock;
+  Condition _progress;
+
+  //! Tasks not yet completed, the first may be running
+  std::deque<Task> _queue;
+
+  //! Set while a thread is, or is about to be, draining the queue
+  bool _scheduled;
+
+  bool _canceled;
+
+  //! Tasks accepted, started and completed so far
+  size_t _submitted;
+  size_t _started;
+  size_t _completed;
+
+  //! Tasks started before this count are interrupted
+  size_t _interrupt;
+
+  //! Thread running the first task, if any
+  ThreadImpl* _current;
+
+  size_t _waiting;
+
+  /**
+   * Get the task to run next, once the previous one, if any, has completed.
+   *
+   * @param n tasks run so far by the calling thread
+   * @param more set if tasks remain once the batch is used up
+   */
+  Task* next(size_t n, bool& more);
+
+  //! Run a batch of tasks on the calling thread; true if more remain
+  bool batch();
+
+ public:
+  StrandImpl(Executor& executor)
+      : _executor(executor),
+        _progress(_lock),
+        _scheduled(false),
+        _canceled(false),
+        _submitted(0),
+        _started(0),
+        _completed(0),
+        _interrupt(0),
+        _current(0),
+        _waiting(0) {}
+
+  void execute(const CountedPtr<StrandImpl>& self, const Task* begin,
+               const Task* end);
+
+  //! Run queued tasks, on a thread of the executor
+  void drain(const CountedPtr<StrandImpl>& self);
+
+  size_t size() {
+    Guard<FastMutex> g(_lock);
+    return _queue.size();
+  }
+
+  void interrupt() {
+    Guard<FastMutex> g(_lock);
+
+    _interrupt = _submitted;
+    if (_current) _current->interrupt();
+  }
+
+  void cancel() {
+    Guard<FastMutex> g(_lock);
+    _canceled = true;
+  }
+
+  bool isCanceled() {
+    Guard<FastMutex> g(_lock);
+    return _canceled;
+  }
+
+  bool wait(unsigned long timeout);
+
+}; /* StrandImpl */
+
+namespace {
+
+//! Drains a Strand from a thread of its executor
+class Drainer : public Runnable {
+  CountedPtr<StrandImpl> _impl;
+
+ public:
+  Drainer(const CountedPtr<StrandImpl>& impl) : _impl(impl) {}
+
+  void run() { _impl->drain(_impl); }
+};
+}
+
+void StrandImpl::execute(const CountedPtr<StrandImpl>& self,
+                         const Task* begin, const Task* end) {
+  size_t n = end - begin;
+  if (n == 0) return;
+
+  {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) throw CancellationException();
+
+    _queue.insert(_queue.end(), begin, end);
+    _submitted += n;
+
+    if (_scheduled) return;
+    _scheduled = true;
+  }
+
+  try {
+    _executor.Execute(Task(new Drainer(self)));
+
+  } catch (...) {
+    bool accepted;
+
+    {
+      Guard<FastMutex> g(_lock);
+
+      // The Strand was idle, so these tasks are still first in line; they
+      // are not accepted, and count as done for anyone waiting
+      _queue.erase(_queue.begin(), _queue.begin() + n);
+
+      _started += n;
+      _completed += n;
+
+      if (_waiting > 0) _progress.Broadcast();
+
+      accepted = !_queue.empty();
+      if (!accepted) _scheduled = false;
+    }
+
+    // Tasks submitted meanwhile were accepted, and have to run somewhere
+    if (accepted)
+      while (batch()) {
+      }
+
+    throw;
+  }
+}
+
+Task* StrandImpl::next(size_t n, bool& more) {
+  Guard<FastMutex> g(_lock);
+
+  if (n > 0) {
+    _queue.pop_front();
+    _current = 0;
+
+    ++_completed;
+    if (_waiting > 0) _progress.Broadcast();
+  }
+
+  if (_queue.empty()) {
+    _scheduled = false;
+    return 0;
+  }
+
+  if (n == StrandBatch) {
+    more = true;
+    return 0;
+  }
+
+  // Interrupt the task if it was submitted before interrupt() was called,
+  // otherwise give it a clean slate; done while holding the lock, so an
+  // interrupt() made once the task is current is not lost
+  ThreadImpl* impl = ThreadImpl::current();
+
+  if (_started++ < _interrupt)
+    impl->interrupt();
+  else
+    impl->isInterrupted();
+
+  _current = impl;
+
+  // Only the draining thread removes tasks, so the first one stays put
+  return &_queue.front();
+}
+
+bool StrandImpl::batch() {
+  bool more = false;
+
+  Task* task;
+  for (size_t n = 0; (task = next(n, more)) != 0; ++n) {
+    try {
+      (*task)->run();
+    } catch (...) {
+      /* consume the exceptions the work propogates */
+    }
+  }
+
+  return more;
+}
+
+void StrandImpl::drain(const CountedPtr<StrandImpl>& self) {
+  if (!batch()) return;
+
+  // Requeue behind the work that reached the executor meanwhile, or carry on
+  // here if it will not take the Strand back
+  try {
+    _executor.Execute(Task(new Drainer(self)));
+  } catch (...) {
+    while (batch()) {
+    }
+  }
+}
+
+bool StrandImpl::wait(unsigned long timeout) {
+  Guard<FastMutex> g(_lock);
+  Time start;
+
+  const size_t target = _submitted;
+  bool done = true;
+
+  ++_waiting;
+
+  try {
+    while (_completed < target) {
+      if (timeout == 0)
+        _progress.Wait();
+
+      else {
+        unsigned long ms = WaiterQueue::elapsed(start);
+        if (ms >= timeout || !_progress.Wait(timeout - ms)) {
+          done = _completed >= target;
+          break;
+        }
+      }
+    }
+
+  } catch (...) {
+    --_waiting;
+    throw;
+  }
+
+  --_waiting;
+  return done;
+}
+
+Strand::Strand(Executor& executor) : _impl(new StrandImpl(executor)) {}
+
+Strand::~Strand() {}
+
+void Strand::Interrupt() { _impl->interrupt(); }
+
+void Strand::Execute(const Task& task) {
+  _impl->execute(_impl, &task, &task + 1);
+}
+
+void Strand::ExecuteAll(const Task* begin, const Task* end) {
+  _impl->execute(_impl, begin, end);
+}
+
+size_t Strand::size() { return _impl->size(); }
+
+void Strand::Cancel() { _impl->cancel(); }
+
+bool Strand::IsCanceled() { return _impl->isCanceled(); }
+
+void Strand::Wait() { _impl->wait(0); }
+
+bool Strand::Wait(unsigned long timeout) {
+  return _impl->wait(timeout == 0 ? 1 : timeout);
+}
+
+KeyedStrand::KeyedStrand(Executor& executor, size_t strands) {
+  if (strands == 0) throw InvalidOpException("No strands");
+
+  _strands.reserve(strands);
+
+  try {
+    for (size_t i = 0; i < strands; ++i)
+      _strands.push_back(new Strand(executor));
+  } catch (...) {
+    for (size_t i = 0; i < _strands.size(); ++i) delete _strands[i];
+    throw;
+  }
+}
+
+KeyedStrand::~KeyedStrand() {
+  for (size_t i = 0; i < _strands.size(); ++i) delete _strands[i];
+}
+
+Strand& KeyedStrand::strand(unsigned long key) {
+  // Mix the bits so keys that differ in only a few bits, such as sequential
+  // ids, are spread over the strands
+  key = ((key >> 16) ^ key) * 0x45d9f3bUL;
+  key = ((key >> 16) ^ key) * 0x45d9f3bUL;
+  key = (key >> 16) ^ key;
+
+  return *_strands[key % _strands.size()];
+}
+
+void KeyedStrand::Execute(unsigned long key, const Task& task) {
+  strand(key).Execute(task);
+}
+
+void KeyedStrand::Interrupt() {
+  for (size_t i = 0; i < _strands.size(); ++i) _strands[i]->Interrupt();
+}
+
+void KeyedStrand::Cancel() {
+  for (size_t i = 0; i < _strands.size(); ++i) _strands[i]->Cancel();
+}
+
+bool KeyedStrand::IsCanceled() { return _strands[0]->IsCanceled(); }
+
+void KeyedStrand::Wait() {
+  for (size_t i = 0; i < _strands.size(); ++i) _strands[i]->Wait();
+}
+
+bool KeyedStrand::Wait(unsigned long timeout) {
+  if (timeout == 0) timeout = 1;
+
+  Time start;
+
+  for (size_t i = 0; i < _strands.size(); ++i) {
+    unsigned long ms = WaiterQueue::elapsed(start);
+    if (ms >= timeout || !_strands[i]->Wait(timeout - ms)) return false;
+  }
+
+  return true;
+}
+
+}  // namespace zthread
@@ -32,19 +32,19 @@ SynchronousExecutor::SynchronousExecutor() : _canceled(false) {}
 
 SynchronousExecutor::~SynchronousExecutor() {}
 
-void SynchronousExecutor::cancel() {
+void SynchronousExecutor::Cancel() {
   Guard<Mutex> g(_lock);
   _canceled = true;
 }
 
-bool SynchronousExecutor::isCanceled() {
+bool SynchronousExecutor::IsCanceled() {
   Guard<Mutex> g(_lock);
   return _canceled;
 }
 
-void SynchronousExecutor::interrupt() {}
+void SynchronousExecutor::Interrupt() {}
 
-void SynchronousExecutor::execute(const Task& task) {
+void SynchronousExecutor::Execute(const Task& task) {
   // Canceled Executors will not accept new tasks, quick
   // check to avoid excessive locking in the canceled state
   if (_canceled) throw CancellationException();
@@ -58,16 +58,16 @@ void SynchronousExecutor::execute(const Task& task) {
   Task(task)->run();
 }
 
-void SynchronousExecutor::wait() {
+void SynchronousExecutor::Wait() {
   if (Thread::interrupted()) throw InterruptedException();
 
   Guard<Mutex> g(_lock);
 }
 
 /**
- * @see Executor::wait(unsigned long)
+ * @see Executor::Wait(unsigned long)
  */
-bool SynchronousExecutor::wait(unsigned long) {
+bool SynchronousExecutor::Wait(unsigned long) {
   if (Thread::interrupted()) throw InterruptedException();
 
   Guard<Mutex> g(_lock);
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/task_graph.h"
+#include "zthread/condition.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+#include "zthread/time.h"
+
+#include "atomic_ops.h"
+#include "waiter_queue.h"
+
+#include <vector>
+
+namespace zthread {
+
+//! Nodes and dependencies of a TaskGraph, and the state of its current run
+class TaskGraphImpl {
+  struct Node {
+    Task task;
+
+    //! Nodes that depend on this one
+    std::vector<size_t> successors;
+
+    //! Number of nodes this one depends on
+    size_t predecessors;
+
+    //! Predecessors that have not completed in the current run
+    volatile size_t pending;
+
+    //! Set if a predecessor failed in the current run
+    volatile bool skip;
+
+    Node(const Task& t) : task(t), predecessors(0), pending(0), skip(false) {}
+  };
+
+  Executor& _executor;
+
+  std::vector<Node> _nodes;
+
+  //! Runnable submitted for each node, reused from run to run
+  std::vector<Task> _runners;
+
+  //! Nodes with no predecessors
+  std::vector<size_t> _roots;
+
+  //! Set once the runners and roots match the nodes and dependencies
+  bool _prepared;
+
+  //! Nodes not yet completed in the current run, and how many failed
+  volatile size_t _remaining;
+  volatile size_t _failed;
+
+  FastMutex _lock;
+  Condition _finished;
+
+  bool _running;
+
+  //! Build the runners and roots, checking that there is no cycle
+  //! @pre the lock is held
+  void prepare();
+
+  //! Submit a node that has become ready
+  void submit(size_t n);
+
+  /**
+   * Complete a node, releasing the nodes that depend on it. The successors
+   * that become ready are submitted, or added to <i>ready</i> if given.
+   */
+  void release(size_t n, bool failed, std::vector<size_t>* ready);
+
+  //! Count a node, or the starting thread, as done with the current run
+  void finish();
+
+ public:
+  TaskGraphImpl(Executor& executor)
+      : _executor(executor),
+        _prepared(false),
+        _remaining(0),
+        _failed(0),
+        _finished(_lock),
+        _running(false) {}
+
+  size_t add(const Task& task);
+
+  void precede(size_t before, size_t after);
+
+  size_t size() {
+    Guard<FastMutex> g(_lock);
+    return _nodes.size();
+  }
+
+  size_t failed() { return atomic::load(&_failed); }
+
+  void start();
+
+  //! Run the task of a node, then release the nodes that depend on it
+  void run(size_t n);
+
+  bool wait(unsigned long timeout);
+
+}; /* TaskGraphImpl */
+
+namespace {
+
+//! Runs one node of a graph; the graph outlives any run in progress
+class NodeRunner : public Runnable {
+  TaskGraphImpl* _graph;
+  size_t _node;
+
+ public:
+  NodeRunner(TaskGraphImpl* graph, size_t node)
+      : _graph(graph), _node(node) {}
+
+  void run() { _graph->run(_node); }
+};
+}
+
+size_t TaskGraphImpl::add(const Task& task) {
+  Guard<FastMutex> g(_lock);
+
+  if (_running) throw InvalidOpException("TaskGraph is running");
+
+  _nodes.push_back(Node(task));
+  _prepared = false;
+
+  return _nodes.size() - 1;
+}
+
+void TaskGraphImpl::precede(size_t before, size_t after) {
+  Guard<FastMutex> g(_lock);
+
+  if (_running) throw InvalidOpException("TaskGraph is running");
+
+  if (before >= _nodes.size() || after >= _nodes.size() || before == after)
+    throw InvalidOpException("Invalid TaskGraph dependency");
+
+  _nodes[before].successors.push_back(after);
+  _nodes[after].predecessors++;
+
+  _prepared = false;
+}
+
+void TaskGraphImpl::prepare() {
+  if (_prepared) return;
+
+  // Check for a cycle by removing the nodes left without predecessors
+  // until none remain
+  std::vector<size_t> pending(_nodes.size());
+  std::vector<size_t> ready;
+
+  for (size_t i = 0; i < _nodes.size(); ++i)
+    if ((pending[i] = _nodes[i].predecessors) == 0) ready.push_back(i);
+
+  std::vector<size_t> roots(ready);
+
+  size_t removed = 0;
+  while (!ready.empty()) {
+    size_t n = ready.back();
+    ready.pop_back();
+    ++removed;
+
+    std::vector<size_t>& s = _nodes[n].successors;
+    for (size_t i = 0; i < s.size(); ++i)
+      if (--pending[s[i]] == 0) ready.push_back(s[i]);
+  }
+
+  if (removed != _nodes.size())
+    throw InvalidOpException("TaskGraph dependencies form a cycle");
+
+  for (size_t i = _runners.size(); i < _nodes.size(); ++i)
+    _runners.push_back(Task(new NodeRunner(this, i)));
+
+  _roots.swap(roots);
+  _prepared = true;
+}
+
+void TaskGraphImpl::start() {
+  {
+    Guard<FastMutex> g(_lock);
+
+    if (_running) throw InvalidOpException("TaskGraph is already running");
+
+    prepare();
+
+    if (_nodes.empty()) return;
+
+    for (size_t i = 0; i < _nodes.size(); ++i) {
+      Node& node = _nodes[i];
+
+      node.pending = node.predecessors;
+      node.skip = false;
+    }
+
+    // Count this thread as well, so the run cannot complete, and be
+    // started again, while the roots are still being submitted
+    atomic::store(&_remaining, _nodes.size() + 1);
+    atomic::store(&_failed, (size_t)0);
+
+    _running = true;
+  }
+
+  // Submit outside the lock; a root may complete before the call returns
+  for (size_t i = 0; i < _roots.size(); ++i) submit(_roots[i]);
+
+  finish();
+}
+
+void TaskGraphImpl::submit(size_t n) {
+  // A node the executor refuses fails, and is completed on this thread. Its
+  // successors are likely to be refused too, so they are kept on a list
+  // rather than recursed into, which a long chain would overflow
+  std::vector<size_t> refused;
+
+  for (;;) {
+    try {
+      _executor.Execute(_runners[n]);
+    } catch (...) {
+      atomic::store(&_nodes[n].skip, true);
+      release(n, true, &refused);
+    }
+
+    if (refused.empty()) return;
+
+    n = refused.back();
+    refused.pop_back();
+  }
+}
+
+void TaskGraphImpl::run(size_t n) {
+  bool failed = atomic::load(&_nodes[n].skip);
+
+  if (!failed) {
+    try {
+      _nodes[n].task->run();
+    } catch (...) {
+      failed = true;
+    }
+  }
+
+  release(n, failed, 0);
+}
+
+void TaskGraphImpl::release(size_t n, bool failed,
+                            std::vector<size_t>* ready) {
+  Node& node = _nodes[n];
+
+  if (failed) atomic::add(&_failed, (size_t)1);
+
+  // The successor whose count reaches zero is the last to see this node
+  // complete, so it is submitted exactly once
+  for (size_t i = 0; i < node.successors.size(); ++i) {
+    size_t s = node.successors[i];
+
+    if (failed) atomic::store(&_nodes[s].skip, true);
+
+    if (atomic::add(&_nodes[s].pending, (size_t)-1) == 0) {
+      if (ready)
+        ready->push_back(s);
+      else
+        submit(s);
+    }
+  }
+
+  finish();
+}
+
+void TaskGraphImpl::finish() {
+  if (atomic::add(&_remaining, (size_t)-1) != 0) return;
+
+  Guard<FastMutex> g(_lock);
+
+  _running = false;
+  _finished.Broadcast();
+}
+
+bool TaskGraphImpl::wait(unsigned long timeout) {
+  Guard<FastMutex> g(_lock);
+  Time start;
+
+  while (_running) {
+    if (timeout == 0)
+      _finished.Wait();
+
+    else {
+      unsigned long ms = WaiterQueue::elapsed(start);
+      if (ms >= timeout || !_finished.Wait(timeout - ms)) return false;
+    }
+  }
+
+  return true;
+}
+
+TaskGraph::TaskGraph(Executor& executor)
+    : _impl(new TaskGraphImpl(executor)) {}
+
+TaskGraph::~TaskGraph() {
+  // Runners refer to the graph without counting, so a run in progress has
+  // to complete first
+  for (;;) {
+    try {
+      _impl->wait(0);
+      break;
+    } catch (InterruptedException&) {
+    }
+  }
+}
+
+TaskGraph::Node TaskGraph::add(const Task& task) { return _impl->add(task); }
+
+void TaskGraph::precede(Node before, Node after) {
+  _impl->precede(before, after);
+}
+
+size_t TaskGraph::size() { return _impl->size(); }
+
+size_t TaskGraph::failed() { return _impl->failed(); }
+
+void TaskGraph::Run() { _impl->start(); }
+
+void TaskGraph::Wait() { _impl->wait(0); }
+
+bool TaskGraph::Wait(unsigned long timeout) {
+  return _impl->wait(timeout == 0 ? 1 : timeout);
+}
+
+}  // namespace zthread
@@ -26,6 +26,7 @@
 
 #include "zthread/thread.h"
 #include "thread_impl.h"
+#include "thread_queue.h"
 #include "zthread/runnable.h"
 
 namespace zthread {
@@ -59,6 +60,10 @@ void Thread::setPriority(Priority n) { _impl->setPriority(n); }
 
 Priority Thread::getPriority() { return _impl->getPriority(); }
 
+bool Thread::setName(const char* name) { return _impl->setName(name); }
+
+unsigned long long Thread::getCpuTime() { return _impl->getCpuTime(); }
+
 bool Thread::interrupt() { return _impl->interrupt(); }
 
 void Thread::Cancel() {
@@ -73,4 +78,12 @@ void Thread::sleep(unsigned long ms) { ThreadImpl::sleep(ms); }
 
 void Thread::yield() { ThreadImpl::yield(); }
 
+void Thread::setCacheTimeout(unsigned long timeout) {
+  ThreadQueue::instance()->idleTimeout(timeout);
+}
+
+unsigned long Thread::getCacheTimeout() {
+  return ThreadQueue::instance()->idleTimeout();
+}
+
 }  // namespace ZThread
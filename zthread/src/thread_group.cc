@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#include "zthread/thread_group.h"
+#include "zthread/condition.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+#include "zthread/thread.h"
+#include "zthread/time.h"
+
+#include "thread_impl.h"
+#include "waiter_queue.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace zthread {
+
+//! State shared by a ThreadGroup and its threads
+class ThreadGroupImpl {
+  typedef std::deque<ThreadImpl*> ThreadList;
+
+  FastMutex _lock;
+
+  //! Signaled when the last running thread completes
+  Condition _empty;
+
+  //! Signaled when any thread completes
+  Condition _completed;
+
+  //! Threads that have started running their task
+  ThreadList _threads;
+
+  //! Threads spawned that have not yet completed
+  size_t _running;
+
+  //! Completions not yet reported by WaitAny()
+  size_t _unreported;
+
+  //! Number of threads blocked on each Condition, so that completions
+  //! nobody is waiting for don't need to signal
+  size_t _emptyWaiters;
+  size_t _completedWaiters;
+
+  //! Bumped by each interrupt(), so threads that start late still see it
+  size_t _generation;
+
+  bool _canceled;
+
+ public:
+  ThreadGroupImpl()
+      : _empty(_lock),
+        _completed(_lock),
+        _running(0),
+        _unreported(0),
+        _emptyWaiters(0),
+        _completedWaiters(0),
+        _generation(0),
+        _canceled(false) {}
+
+  //! Account for a thread about to be spawned
+  size_t add() {
+    Guard<FastMutex> g(_lock);
+
+    if (_canceled) throw CancellationException();
+
+    ++_running;
+    return _generation;
+  }
+
+  //! Called by each thread before it runs its task
+  void registerThread(size_t generation) {
+    Guard<FastMutex> g(_lock);
+
+    ThreadImpl* impl = ThreadImpl::current();
+
+    // Catch up with an interrupt() or cancel() that happened while
+    // the thread was starting
+    if (_canceled)
+      impl->cancel();
+    else if (_generation != generation)
+      impl->interrupt();
+
+    _threads.push_back(impl);
+  }
+
+  //! Called by each thread once its task is done
+  void unregisterThread() {
+    Guard<FastMutex> g(_lock);
+
+    _threads.erase(
+        std::find(_threads.begin(), _threads.end(), ThreadImpl::current()));
+
+    remove(true);
+  }
+
+  //! Remove a thread that never started
+  void abandon() {
+    Guard<FastMutex> g(_lock);
+    remove(false);
+  }
+
+  size_t size() {
+    Guard<FastMutex> g(_lock);
+    return _running;
+  }
+
+  void interrupt() {
+    Guard<FastMutex> g(_lock);
+
+    ++_generation;
+
+    for (ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+      (*i)->interrupt();
+  }
+
+  void cancel() {
+    Guard<FastMutex> g(_lock);
+
+    _canceled = true;
+
+    for (ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+      (*i)->cancel();
+  }
+
+  bool isCanceled() {
+    Guard<FastMutex> g(_lock);
+    return _canceled;
+  }
+
+  bool wait(unsigned long timeout) {
+    Guard<FastMutex> g(_lock);
+    Time start;
+
+    while (_running > 0)
+      if (!block(_empty, _emptyWaiters, start, timeout)) return false;
+
+    return true;
+  }
+
+  bool waitAny(unsigned long timeout) {
+    Guard<FastMutex> g(_lock);
+    Time start;
+
+    while (_unreported == 0) {
+      // Nothing left that could complete
+      if (_running == 0) return true;
+
+      if (!block(_completed, _completedWaiters, start, timeout)) return false;
+    }
+
+    --_unreported;
+    return true;
+  }
+
+ private:
+  /**
+   * Update the count of running threads, waking the waiters that are
+   * interested.
+   *
+   * @pre the lock is held
+   */
+  void remove(bool completed) {
+    assert(_running > 0);
+    --_running;
+
+    if (completed) {
+      ++_unreported;
+      if (_completedWaiters > 0) _completed.Broadcast();
+    }
+
+    if (_running == 0) {
+      if (_emptyWaiters > 0) _empty.Broadcast();
+
+      // Let WaitAny() notice there is nothing left to wait for
+      if (!completed && _completedWaiters > 0) _completed.Broadcast();
+    }
+  }
+
+  /**
+   * Wait on the given Condition for what remains of the timeout.
+   *
+   * @pre the lock is held
+   * @return bool false if the timeout expired
+   */
+  bool block(Condition& cond, size_t& waiters, const Time& start,
+             unsigned long timeout) {
+    unsigned long remaining = 0;
+
+    if (timeout != 0) {
+      unsigned long ms = WaiterQueue::elapsed(start);
+      if (ms >= timeout) return false;
+
+      remaining = timeout - ms;
+    }
+
+    bool signaled = true;
+    ++waiters;
+
+    try {
+      if (remaining == 0)
+        cond.Wait();
+      else
+        signaled = cond.Wait(remaining);
+
+    } catch (...) {
+      --waiters;
+      throw;
+    }
+
+    --waiters;
+    return signaled;
+  }
+
+}; /* ThreadGroupImpl */
+
+namespace {
+
+//! Run a task, reporting to the group before and after
+class Member : public Runnable {
+  CountedPtr<ThreadGroupImpl> _impl;
+  Task _task;
+
+  size_t _generation;
+
+ public:
+  Member(const CountedPtr<ThreadGroupImpl>& impl, const Task& task,
+         size_t generation)
+      : _impl(impl), _task(task), _generation(generation) {}
+
+  void run() {
+    _impl->registerThread(_generation);
+
+    try {
+      _task->run();
+    } catch (...) {
+      /* consume the exceptions the work propogates */
+    }
+
+    _impl->unregisterThread();
+  }
+
+}; /* Member */
+}
+
+ThreadGroup::ThreadGroup() : _impl(new ThreadGroupImpl) {}
+
+ThreadGroup::~ThreadGroup() {}
+
+void ThreadGroup::Spawn(const Task& task) {
+  Task member(new Member(_impl, task, _impl->add()));
+
+  try {
+    Thread t(member);
+
+  } catch (...) {
+    _impl->abandon();
+    throw;
+  }
+}
+
+size_t ThreadGroup::Size() { return _impl->size(); }
+
+void ThreadGroup::interrupt() { _impl->interrupt(); }
+
+void ThreadGroup::Cancel() { _impl->cancel(); }
+
+bool ThreadGroup::IsCanceled() { return _impl->isCanceled(); }
+
+void ThreadGroup::Wait() { _impl->wait(0); }
+
+bool ThreadGroup::Wait(unsigned long timeout) {
+  return _impl->wait(timeout == 0 ? 1 : timeout);
+}
+
+void ThreadGroup::WaitAny() { _impl->waitAny(0); }
+
+bool ThreadGroup::WaitAny(unsigned long timeout) {
+  return _impl->waitAny(timeout == 0 ? 1 : timeout);
+}
+
+}  // namespace zthread
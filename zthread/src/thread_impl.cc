@@ -47,24 +47,63 @@ class Launcher : public Runnable {
  public:
   Launcher(ThreadImpl* a, ThreadImpl* b, const Task& c) : x(a), y(b), z(c) {}
 
-  void run() { y->dispatch(x, y, z); }
+  void run() {
+    // Remember the name the native thread started with, a reused thread
+    // should not keep a name given to it by an earlier task
+    char name[16];
+    bool named = ThreadOps::getName(name, sizeof(name));
+
+    // Keep running tasks on this native thread for as long as it is
+    // handed another one while parked
+    for (Launcher* launch = this; launch != 0;) {
+      ThreadImpl* impl = launch->y;
+      ThreadImpl::dispatch(launch->x, impl, launch->z);
+
+      // The completed ThreadImpl is released once the thread is reused
+      Priority p = impl->getPriority();
+
+      launch = static_cast<Launcher*>(
+          ThreadQueue::instance()->insertIdleThread(impl));
+
+      if (launch != 0) {
+        // Map the next ThreadImpl onto this native thread
+        ThreadOps::activate(launch->y);
+
+        if (launch->y->getPriority() != p)
+          ThreadOps::setPriority(launch->y, launch->y->getPriority());
+
+        if (named) ThreadOps::setName(launch->y, name);
+      }
+    }
+  }
 };
 }
 
 ThreadImpl::ThreadImpl()
-    : _state(State::REFERENCE), _priority(Medium), _autoCancel(false) {
+    : _joiners(0),
+      _tls(0),
+      _cpuTime(0),
+      _state(State::REFERENCE),
+      _priority(Medium),
+      _autoCancel(false) {
   ZTDEBUG("Reference thread created.\n");
 }
 
 ThreadImpl::ThreadImpl(const Task& task, bool autoCancel)
-    : _state(State::IDLE), _priority(Medium), _autoCancel(autoCancel) {
+    : _joiners(0),
+      _tls(0),
+      _cpuTime(0),
+      _state(State::IDLE),
+      _priority(Medium),
+      _autoCancel(autoCancel) {
   ZTDEBUG("User thread created.\n");
 
   start(task);
 }
 
 ThreadImpl::~ThreadImpl() {
-  _tls.clear();
+  delete _tls;
+  delete _joiners;
 
   if (isActive()) {
     ZTDEBUG("You are destroying an executing thread!\n");
@@ -88,6 +127,11 @@ bool ThreadImpl::isCanceled() { return _monitor.isCanceled(); }
 
 Priority ThreadImpl::getPriority() const { return _priority; }
 
+ThreadImpl::ThreadLocalMap& ThreadImpl::getThreadLocalMap() {
+  if (!_tls) _tls = new ThreadLocalMap;
+  return *_tls;
+}
+
 bool ThreadImpl::isReference() { return _state.isReference(); }
 
 /**
@@ -118,7 +162,9 @@ bool ThreadImpl::join(unsigned long timeout) {
   if (!_state.isJoined()) {
     // Add the current thread to the joiner list
     ThreadImpl* impl = current();
-    _joiners.push_back(impl);
+
+    if (!_joiners) _joiners = new List;
+    _joiners->push_back(impl);
 
     Monitor::STATE result;
 
@@ -132,9 +178,11 @@ bool ThreadImpl::join(unsigned long timeout) {
       _monitor.Acquire();
     }
 
-    // Update the joiner list
-    List::iterator i = std::find(_joiners.begin(), _joiners.end(), impl);
-    if (i != _joiners.end()) _joiners.erase(i);
+    // Update the joiner list, unless the thread completed and released it
+    if (_joiners) {
+      List::iterator i = std::find(_joiners->begin(), _joiners->end(), impl);
+      if (i != _joiners->end()) _joiners->erase(i);
+    }
 
     switch (result) {
       case Monitor::TIMEDOUT:
@@ -175,6 +223,38 @@ void ThreadImpl::setPriority(Priority p) {
   _priority = p;
 }
 
+/**
+ * Name the native thread, so that tools like top, perf and gdb can tell
+ * threads apart. Only threads that are running can be named.
+ *
+ * @param name new name for the thread
+ * @return bool false if the name could not be set
+ */
+bool ThreadImpl::setName(const char* name) {
+  Guard<Monitor> g(_monitor);
+
+  if (!_state.isRunning() && !_state.isReference()) return false;
+
+  return ThreadOps::setName(this, name);
+}
+
+/**
+ * Get the CPU time consumed by the task this thread runs. For reference
+ * threads, this is the CPU time consumed by the native thread.
+ *
+ * @return unsigned long long CPU time in microseconds, 0 if unavailable
+ */
+unsigned long long ThreadImpl::getCpuTime() {
+  Guard<Monitor> g(_monitor);
+
+  if (_state.isJoined()) return _cpuTime;
+
+  unsigned long long t = 0;
+  if (_state.isIdle() || !ThreadOps::getCpuTime(this, t)) return 0;
+
+  return t - _cpuTime;
+}
+
 /**
  * Test the state Monitor of this thread to determine if the thread
  * is an active thread created by zthreads.
@@ -287,7 +367,9 @@ void ThreadImpl::start(const Task& task) {
   // Attempt to start the child thread
   Guard<Monitor> g2(parent->_monitor);
 
-  if (!spawn(&launch)) {
+  // Hand the task to a parked thread when one is available, otherwise
+  // spawn a new one
+  if (!ThreadQueue::instance()->resumeIdleThread(&launch) && !spawn(&launch)) {
     // Return to the idle state & report the error if it doesn't work out.
     _state.setIdle();
     throw SynchronizationException();
@@ -321,10 +403,14 @@ void ThreadImpl::dispatch(ThreadImpl* parent, ThreadImpl* impl, Task task) {
   // Inherit ThreadLocal values from the parent
   typedef ThreadLocalMap::const_iterator It;
 
-  for (It i = parent->getThreadLocalMap().begin();
-       i != parent->getThreadLocalMap().end(); ++i)
-    if ((i->second)->isInheritable())
-      impl->getThreadLocalMap()[i->first] = (i->second)->clone();
+  if (parent->_tls)
+    for (It i = parent->_tls->begin(); i != parent->_tls->end(); ++i)
+      if ((i->second)->isInheritable())
+        impl->getThreadLocalMap()[i->first] = (i->second)->clone();
+
+  // Account only for the CPU time used by this task, the native thread
+  // may have run others before it
+  if (!ThreadOps::getCpuTime(impl, impl->_cpuTime)) impl->_cpuTime = 0;
 
   // Insert a user-thread mapping
   ThreadQueue::instance()->insertUserThread(impl);
@@ -346,45 +432,59 @@ void ThreadImpl::dispatch(ThreadImpl* parent, ThreadImpl* impl, Task task) {
   {  // Update the state of the thread
 
     Guard<Monitor> g(impl->_monitor);
+
+    // Keep the CPU time consumed by the task, the native thread can not be
+    // queried once it is joined
+    unsigned long long t = 0;
+    impl->_cpuTime =
+        ThreadOps::getCpuTime(impl, t) ? t - impl->_cpuTime : 0;
+
     impl->_state.setJoined();
 
-    // Wake the joiners that will be easy to join first
-    for (List::iterator i = impl->_joiners.begin();
-         i != impl->_joiners.end();) {
-      ThreadImpl* joiner = *i;
-      Monitor& m = joiner->getMonitor();
+    List* joiners = impl->_joiners;
+    impl->_joiners = 0;
 
-      if (m.TryAcquire()) {
-        m.notify();
-        m.Release();
+    if (joiners) {
+      // Wake the joiners that will be easy to join first
+      for (List::iterator i = joiners->begin(); i != joiners->end();) {
+        ThreadImpl* joiner = *i;
+        Monitor& m = joiner->getMonitor();
 
-        i = impl->_joiners.erase(i);
+        if (m.TryAcquire()) {
+          m.notify();
+          m.Release();
 
-      } else
-        ++i;
-    }
+          i = joiners->erase(i);
 
-    // Wake the joiners that might take a while next
-    for (List::iterator i = impl->_joiners.begin(); i != impl->_joiners.end();
-         ++i) {
-      ThreadImpl* joiner = *i;
-      Monitor& m = joiner->getMonitor();
+        } else
+          ++i;
+      }
+
+      // Wake the joiners that might take a while next
+      for (List::iterator i = joiners->begin(); i != joiners->end(); ++i) {
+        ThreadImpl* joiner = *i;
+        Monitor& m = joiner->getMonitor();
+
+        m.Acquire();
+        m.notify();
+        m.Release();
+      }
 
-      m.Acquire();
-      m.notify();
-      m.Release();
+      delete joiners;
     }
   }
 
   ZTDEBUG("Thread exiting...\n");
 
-  // Insert a pending-thread mapping, allowing the resources to be reclaimed
-  ThreadQueue::instance()->insertPendingThread(impl);
+  // Cleanup ThreadLocal values, detaching the map first in case a value
+  // refers to a ThreadLocal as it is destroyed
+  ThreadLocalMap* tls = impl->_tls;
+  impl->_tls = 0;
 
-  // Cleanup ThreadLocal values
-  impl->getThreadLocalMap().clear();
+  delete tls;
 
-  // Update the reference count allowing it to be destroyed
+  // Update the reference count allowing it to be destroyed, the Launcher
+  // then parks or reclaims the native thread through the ThreadQueue
   impl->delReference();
 }
 
@@ -37,8 +37,8 @@
 #include "thread_ops.h"
 #include "tss.h"
 
-#include <deque>
 #include <map>
+#include <vector>
 
 namespace zthread {
 
@@ -49,7 +49,7 @@ namespace zthread {
  * @version 2.3.0
  */
 class ThreadImpl : public IntrusivePtr<ThreadImpl, FastLock>, public ThreadOps {
-  typedef std::deque<ThreadImpl*> List;
+  typedef std::vector<ThreadImpl*> List;
 
   //! TSS to store implementation to current thread mapping.
   static TSS<ThreadImpl*> _threadMap;
@@ -57,18 +57,27 @@ class ThreadImpl : public IntrusivePtr<ThreadImpl, FastLock>, public ThreadOps {
   //! The Monitor for controlling this thread
   Monitor _monitor;
 
-  //! Current state for the thread
-  State _state;
-
-  //! Joining threads
-  List _joiners;
-
  public:
   typedef std::map<const ThreadLocalImpl*, ThreadLocalImpl::ValuePtr>
       ThreadLocalMap;
 
  private:
-  ThreadLocalMap _tls;
+  // Most threads are never joined by more than a single thread, if at all,
+  // and most never use a ThreadLocal. Both are allocated on first use so an
+  // idle thread carries only the pointers.
+
+  //! Joining threads, guarded by the Monitor
+  List* _joiners;
+
+  //! ThreadLocal values, accessed only by this thread
+  ThreadLocalMap* _tls;
+
+  //! CPU time of the native thread when the task started, or the CPU time
+  //! the task consumed once the thread is joined (microseconds)
+  unsigned long long _cpuTime;
+
+  //! Current state for the thread
+  State _state;
 
   //! Cached thread priority
   Priority _priority;
@@ -97,13 +106,16 @@ class ThreadImpl : public IntrusivePtr<ThreadImpl, FastLock>, public ThreadOps {
 
   Priority getPriority() const;
 
-  //  ThreadLocalMap& getThreadLocalMap();
-  ThreadLocalMap& getThreadLocalMap() { return _tls; }
+  ThreadLocalMap& getThreadLocalMap();
 
   bool join(unsigned long);
 
   void setPriority(Priority);
 
+  bool setName(const char*);
+
+  unsigned long long getCpuTime();
+
   bool isActive();
 
   bool isReference();
@@ -34,7 +34,9 @@
 
 namespace zthread {
 
-ThreadQueue::ThreadQueue() : _waiter(0) { ZTDEBUG("ThreadQueue created\n"); }
+ThreadQueue::ThreadQueue() : _idleTimeout(0), _waiter(0) {
+  ZTDEBUG("ThreadQueue created\n");
+}
 
 ThreadQueue::~ThreadQueue() {
   ZTDEBUG("ThreadQueue waiting on remaining threads...\n");
@@ -57,6 +59,11 @@ ThreadQueue::~ThreadQueue() {
 
       threadsWaiting = !_userThreads.empty() || !_pendingThreads.empty();
 
+      // Stop parking threads, and release those already parked so they
+      // transition into pending-threads
+      _idleTimeout = 0;
+      pollIdleThreads();
+
       // ZTDEBUG("Wait required:   %d\n", waitRequired);
       // ZTDEBUG("Threads waiting: %d\n", threadsWaiting);
 
@@ -94,7 +101,7 @@ ThreadQueue::~ThreadQueue() {
     // ZTDEBUG("Threads waiting: %d %d\n", _userThreads.size(),
     // _pendingThreads.size());
 
-    // Avoid race-condition where the last threads are done with thier tasks,
+    // Avoid race-condition where the last threads are done with their tasks,
     // but
     // only begin the final part of the clean up phase after this destructor
     // begins
@@ -141,7 +148,7 @@ void ThreadQueue::insertPendingThread(ThreadImpl* impl) {
     if (_waiter && _waiter != (ThreadImpl*)1)
       _waiter->getMonitor().notify();
     else
-      _waiter = (ThreadImpl*)!_waiter;
+      _waiter = (ThreadImpl*)1;
   }
 
   ZTDEBUG("1 pending-thread added.\n");
@@ -161,8 +168,12 @@ void ThreadQueue::insertUserThread(ThreadImpl* impl) {
   // Reclaim pending-threads
   pollPendingThreads();
 
-  // Auto-cancel threads that are started when main() is out of scope
-  if (_waiter) impl->cancel(true);
+  // A wait for this thread is needed again, unless main() is already out
+  // of scope; then auto-cancel threads that are started
+  if (_waiter == (ThreadImpl*)1)
+    _waiter = 0;
+  else if (_waiter)
+    impl->cancel(true);
 
   ZTDEBUG("1 user-thread added.\n");
 }
@@ -207,6 +218,128 @@ void ThreadQueue::pollUserThreads() {
   }
 }
 
+Runnable* ThreadQueue::insertIdleThread(ThreadImpl* impl) {
+  IdleThread idle(impl);
+  unsigned long timeout = 0;
+
+  Monitor& m = impl->getMonitor();
+
+  // Only a hand-off, a release or the idle timeout should end the wait;
+  // interrupting a thread that has completed its task has no effect
+  m.interest(static_cast<Monitor::STATE>(Monitor::SIGNALED | Monitor::TIMEDOUT));
+
+  {
+    Guard<FastLock> g(_lock);
+
+    if ((timeout = _idleTimeout) != 0) _idleThreads.push_back(&idle);
+  }
+
+  bool reused = false;
+
+  while (timeout != 0) {
+    Monitor::STATE state;
+
+    {
+      Guard<Monitor> g1(m);
+      state = m.wait(timeout);
+    }
+
+    Guard<FastLock> g2(_lock);
+
+    if ((reused = (idle.launcher != 0))) {
+      // The next task is mapped to a new ThreadImpl
+      ThreadList::iterator i =
+          std::find(_userThreads.begin(), _userThreads.end(), impl);
+      if (i != _userThreads.end()) _userThreads.erase(i);
+
+      break;
+    }
+
+    IdleList::iterator i =
+        std::find(_idleThreads.begin(), _idleThreads.end(), &idle);
+
+    // Released by pollIdleThreads()
+    if (i == _idleThreads.end()) break;
+
+    // Otherwise, the wait ended with a stale signal; keep waiting
+    if (state == Monitor::TIMEDOUT) {
+      _idleThreads.erase(i);
+      break;
+    }
+  }
+
+  m.interest(Monitor::ANYTHING);
+
+  if (!reused) {
+    insertPendingThread(impl);
+    return 0;
+  }
+
+  ZTDEBUG("1 idle-thread reused.\n");
+
+  // Nothing else will reclaim the ThreadImpl from the completed task
+  impl->delReference();
+
+  return idle.launcher;
+}
+
+bool ThreadQueue::resumeIdleThread(Runnable* launcher) {
+  ThreadImpl* impl = 0;
+
+  {
+    Guard<FastLock> g(_lock);
+
+    if (_idleThreads.empty()) return false;
+
+    // The most recently parked thread is the most likely to still be warm
+    IdleThread* idle = _idleThreads.back();
+    _idleThreads.pop_back();
+
+    idle->launcher = launcher;
+
+    // Keep the parked ThreadImpl alive until it has been notified, a stale
+    // signal might let it pick up the launcher and release itself first
+    impl = idle->impl;
+    impl->addReference();
+  }
+
+  // The hand-off is guarded by the ThreadQueue, so the parked thread is
+  // notified without holding any lock it needs once it wakes
+  impl->getMonitor().notify();
+  impl->delReference();
+
+  return true;
+}
+
+void ThreadQueue::idleTimeout(unsigned long timeout) {
+  Guard<FastLock> g(_lock);
+
+  // Ignore requests that arrive after shutdown has begun
+  if (_waiter && _waiter != (ThreadImpl*)1) return;
+
+  _idleTimeout = timeout;
+
+  if (timeout == 0) pollIdleThreads();
+}
+
+unsigned long ThreadQueue::idleTimeout() {
+  Guard<FastLock> g(_lock);
+  return _idleTimeout;
+}
+
+void ThreadQueue::pollIdleThreads() {
+  ZTDEBUG("pollIdleThreads()\n");
+
+  // Wake each parked thread without a launcher, the thread will find
+  // itself removed from the idle list and exit
+  for (IdleList::iterator i = _idleThreads.begin(); i != _idleThreads.end();
+       i = _idleThreads.erase(i)) {
+    (*i)->impl->getMonitor().notify();
+
+    ZTDEBUG("1 idle-thread released.\n");
+  }
+}
+
 void ThreadQueue::insertShutdownTask(Task& task) {
   bool hasWaiter = false;
 
@@ -214,7 +347,7 @@ void ThreadQueue::insertShutdownTask(Task& task) {
     Guard<FastLock> g(_lock);
 
     // Execute later when the ThreadQueue is destroyed
-    if (!(hasWaiter = (_waiter != 0))) {
+    if (!(hasWaiter = (_waiter && _waiter != (ThreadImpl*)1))) {
       _shutdownTasks.push_back(task);
       // ZTDEBUG("1 shutdown task added. %d\n", _shutdownTasks.size());
     }
@@ -31,9 +31,12 @@
 #include "zthread/guard.h"
 #include "zthread/singleton.h"
 
+#include <deque>
+
 namespace zthread {
 
 class ThreadImpl;
+class Runnable;
 
 /**
  * @class ThreadQueue
@@ -54,11 +57,26 @@ class ThreadQueue : public Singleton<ThreadQueue, StaticInstantiation> {
   typedef std::deque<ThreadImpl*> ThreadList;
   typedef std::deque<Task> TaskList;
 
+  //! A parked thread, and the launcher it is handed when reused
+  typedef struct idle_t {
+    ThreadImpl* impl;
+    Runnable* launcher;
+    idle_t(ThreadImpl* i) : impl(i), launcher(0) {}
+  } IdleThread;
+
+  typedef std::deque<IdleThread*> IdleList;
+
   //! Managed thread lists
   ThreadList _pendingThreads;
   ThreadList _referenceThreads;
   ThreadList _userThreads;
 
+  //! User-threads that completed thier tasks and are parked for reuse
+  IdleList _idleThreads;
+
+  //! Time (milliseconds) a thread stays parked, 0 disables reuse
+  unsigned long _idleTimeout;
+
   //! Shutdown handlers
   TaskList _shutdownTasks;
 
@@ -99,6 +117,34 @@ class ThreadQueue : public Singleton<ThreadQueue, StaticInstantiation> {
    */
   void insertPendingThread(ThreadImpl*);
 
+  /**
+   * Park a user-thread that has completed its task, so that its native thread
+   * can be handed the next task started by ThreadImpl::start() instead of a
+   * new thread being spawned. Parked threads remain user-threads; a thread
+   * that is not reused before the idle timeout expires, or when reuse is
+   * disabled, is transitioned to a pending-thread.
+   *
+   * @return Runnable* launcher for the next task to run on this native
+   *         thread, or 0 if the native thread should exit.
+   */
+  Runnable* insertIdleThread(ThreadImpl*);
+
+  /**
+   * Hand a launcher to the most recently parked thread.
+   *
+   * @return bool false if no parked thread was available.
+   */
+  bool resumeIdleThread(Runnable*);
+
+  /**
+   * Set the time (milliseconds) threads are parked for reuse. A value
+   * of 0 disables reuse, and releases any threads currently parked.
+   */
+  void idleTimeout(unsigned long);
+
+  //! Get the time (milliseconds) threads are parked for reuse.
+  unsigned long idleTimeout();
+
   /**
    * Insert reference thread. Reference threads are not removed until
    * the ThreadQueue goes out of scope.
@@ -123,6 +169,8 @@ class ThreadQueue : public Singleton<ThreadQueue, StaticInstantiation> {
   void pollUserThreads();
 
   void pollReferenceThreads();
+
+  void pollIdleThreads();
 };
 
 }  // namespace ZThread
@@ -29,281 +29,152 @@
 #include "zthread/guard.h"
 #include "zthread/time.h"
 
+#include "metrics_shard.h"
 #include "thread_impl.h"
+#include "waiter_queue.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
 
 namespace zthread {
 
 namespace {
 
-//!
-class WaiterQueue {
-  typedef std::deque<ThreadImpl*> ThreadList;
+FastMutex executorIdLock;
+size_t lastExecutorId = 0;
 
-  typedef struct group_t {
-    size_t id;
-    size_t count;
-    ThreadList waiters;
-    group_t(size_t n) : id(n), count(0) {}
-  } Group;
-
-  typedef std::deque<Group> GroupList;
-
-  //! Predicate to find a specific group
-  struct by_id : public std::unary_function<bool, Group> {
-    size_t id;
-    by_id(size_t n) : id(n) {}
-    bool operator()(const Group& grp) { return grp.id == id; }
-  };
-
-  //! Functor to count groups
-  struct counter : public std::unary_function<void, Group> {
-    size_t count;
-    counter() : count(0) {}
-    void operator()(const Group& grp) { count += grp.count; }
-    operator size_t() { return count; }
-  };
+//! Number the executors so their threads can be told apart
+size_t nextExecutorId() {
+  Guard<FastMutex> g(executorIdLock);
+  return ++lastExecutorId;
+}
+}
+//! Synchronization point for the Executor
+class ThreadedExecutorImpl {
+  typedef std::deque<ThreadImpl*> ThreadList;
 
+  bool _canceled;
   FastMutex _lock;
-  GroupList _list;
-  size_t _id;
-  size_t _generation;
 
- public:
-  WaiterQueue() : _id(0), _generation(0) {
-    // At least one empty-group exists
-    _list.push_back(Group(_id++));
-  }
+  //! Worker threads
+  ThreadList _threads;
 
-  /**
-   * Insert the current thread into the current waiter list
-   *
-   * @pre  At least one empty group exists
-   * @post At least one empty group exists
-   */
-  bool wait(unsigned long timeout) {
-    ThreadImpl* self = ThreadImpl::current();
-    Monitor& m = self->getMonitor();
+  WaiterQueue _queue;
 
-    Monitor::STATE state;
+  //! Identifies this executor in the names of its threads
+  size_t _id;
 
-    Guard<Lockable> g1(_lock);
+  //! Number of threads started so far
+  size_t _started;
 
-    // At least one empty-group exists
-    assert(!_list.empty());
+  //! CPU time consumed by threads that have exited (microseconds)
+  unsigned long long _cpuTime;
 
-    // Return w/o waiting if there are no executing tasks
-    if ((size_t)std::for_each(_list.begin(), _list.end(), counter()) < 1)
-      return true;
+  //! Counters of each thread, reused by later threads once one exits
+  std::vector<MetricsShard*> _shards;
 
-    // Update the waiter list for the active group
-    _list.back().waiters.push_back(self);
-    size_t n = _list.back().id;
+  //! Most tasks ever seen waiting for their thread to start
+  size_t _peak;
 
-    m.Acquire();
+  //! Tasks whose thread has not yet started
+  //! @pre the lock is held
+  size_t queued() {
+    size_t n = getWaiterQueue().pending();
+    return n > _threads.size() ? n - _threads.size() : 0;
+  }
 
-    {
-      Guard<Lockable, UnlockedScope> g2(g1);
-      state = timeout == 0 ? m.wait() : m.wait(timeout);
-    }
+ public:
+  ThreadedExecutorImpl()
+      : _canceled(false),
+        _id(nextExecutorId()),
+        _started(0),
+        _cpuTime(0),
+        _peak(0) {}
+
+  ~ThreadedExecutorImpl() {
+    for (size_t i = 0; i < _shards.size(); ++i) delete _shards[i];
+  }
 
-    m.Release();
-
-    // If awoke due to a reason other than the last task in the group 'n'
-    // completing,
-    // then then find the group 'self' is waiting in
-    GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-    if (i != _list.end()) {
-      // Remove 'self' from that list if it is still a member
-      ThreadList::iterator j =
-          std::find(i->waiters.begin(), i->waiters.end(), self);
-      if (j != i->waiters.end()) i->waiters.erase(j);
-    }
+  WaiterQueue& getWaiterQueue() { return _queue; }
 
-    // At least one empty-group exists
-    assert(!_list.empty());
-
-    switch (state) {
-      case Monitor::SIGNALED:
-        break;
-      case Monitor::TIMEDOUT:
-        return false;
-      case Monitor::INTERRUPTED:
-        throw InterruptedException();
-      default:
-        throw SynchronizationException();
-    }
+  //! Register the current thread, returning the shard it records its task in
+  MetricsShard& registerThread(size_t generation) {
+    ThreadImpl* impl = ThreadImpl::current();
+    MetricsShard* shard = 0;
+    size_t n;
 
-    return true;
-  }
+    {
+      Guard<FastMutex> g(_lock);
 
-  /**
-   * Increment the active group count
-   *
-   * @pre at least 1 empty group exists
-   * @post at least 1 non-empty group exists
-   */
-  std::pair<size_t, size_t> increment() {
-    Guard<FastMutex> g(_lock);
+      // Track every thread, so its CPU time is accounted for
+      _threads.push_back(impl);
+      n = _started++;
+
+      size_t backlog = queued() + 1;
+      if (backlog > _peak) _peak = backlog;
 
-    // At least one empty-group exists
-    assert(!_list.empty());
+      // Take over the shard of a thread that exited
+      for (size_t i = 0; i < _shards.size() && !shard; ++i)
+        if (!_shards[i]->active()) shard = _shards[i];
 
-    GroupList::iterator i = --_list.end();
-    size_t n = i->id;
+      if (!shard) {
+        shard = new MetricsShard();
+        _shards.push_back(shard);
+      }
 
-    if (i == _list.end()) {
-      // A group should never have been removed until
-      // the final task in that group completed
-      assert(0);
+      shard->attach();
     }
 
-    i->count++;
+    // Interrupt slow starting threads, the others remain registered
+    // for possible future interrupt()
+    if (getWaiterQueue().generation() != generation) impl->interrupt();
 
-    // When the active group is being incremented, insert a new active group
-    // to replace it if there were waiting threads
-    if (i == --_list.end() && !i->waiters.empty())
-      _list.push_back(Group(_id++));
+    // Name the thread after its executor, e.g. threaded-2-t5
+    char name[32];
+    sprintf(name, "threaded-%lu-t%lu", (unsigned long)_id, (unsigned long)n);
 
-    // At least 1 non-empty group exists
-    assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
+    impl->setName(name);
 
-    return std::make_pair(n, _generation);
+    return *shard;
   }
 
-  /**
-   * Decrease the count for the group with the given id.
-   *
-   * @param n group id
-   *
-   * @pre  At least 1 non-empty group exists
-   * @post At least 1 empty group exists
-   */
-  void decrement(size_t n) {
-    Guard<FastMutex> g1(_lock);
-
-    // At least 1 non-empty group exists
-    assert((size_t)std::for_each(_list.begin(), _list.end(), counter()) > 0);
-
-    // Find the requested group
-    GroupList::iterator i = std::find_if(_list.begin(), _list.end(), by_id(n));
-    if (i == _list.end()) {
-      // A group should never have been removed until
-      // the final task in that group completed
-      assert(0);
-    }
+  //! Unregister the current thread, once its task has run
+  void unregisterThread(MetricsShard& shard) {
+    Guard<FastMutex> g(_lock);
 
-    // Decrease the count for tasks in this group,
-    if (--i->count == 0 && i == _list.begin()) {
-      do {
-        // When the first group completes, wake all waiters for every
-        // group, starting from the first until a group that is not
-        // complete is reached
-
-        /*
-        // Don't remove the empty active group
-        if(i == --_list.end() && i->waiters.empty())
-          break;
-        */
-
-        if (awaken(*i)) {
-          // If all waiters were awakened, remove the group
-          i = _list.erase(i);
-
-        } else {
-          {
-            // Otherwise, unlock and yield allowing the waiter
-            // lists to be updated if other threads are busy
-            Guard<FastLock, UnlockedScope> g2(g1);
-            ThreadImpl::yield();
-          }
-
-          i = _list.begin();
-        }
-
-      } while (i != _list.end() && i->count == 0);
-
-      // Ensure that an active group exists
-      if (_list.empty()) _list.push_back(Group(++_id));
-    }
+    shard.detach();
 
-    // At least one group exists
-    assert(!_list.empty());
+    ThreadImpl* impl = ThreadImpl::current();
+    _cpuTime += impl->getCpuTime();
+
+    _threads.erase(std::remove(_threads.begin(), _threads.end(), impl),
+                   _threads.end());
   }
 
-  /**
-   */
-  size_t generation(bool next = false) {
+  //! CPU time consumed by current and former threads (microseconds)
+  unsigned long long cpuTime() {
     Guard<FastMutex> g(_lock);
-    return next ? _generation++ : _generation;
-  }
 
- private:
-  /**
-   * Awaken all the waiters remaining in the given group
-   *
-   * @return
-   *   - true if all the waiting threads were successfully awakened.
-   *   - false if there were one or more threads that could not be awakened.
-   */
-  bool awaken(Group& grp) {
-    // Go through the waiter list in the given group;
-    for (ThreadList::iterator i = grp.waiters.begin();
-         i != grp.waiters.end();) {
-      ThreadImpl* impl = *i;
-      Monitor& m = impl->getMonitor();
-
-      // Try the monitor lock, if it cant be locked skip to the next waiter
-      if (m.TryAcquire()) {
-        // Notify the monitor & remove from the waiter list so time isn't
-        // wasted checking it again.
-        i = grp.waiters.erase(i);
-
-        // Try to wake the waiter, it doesn't matter if this is successful
-        // or not (only fails when the monitor is already going to stop
-        // waiting).
-        m.notify();
-        m.Release();
-
-      } else
-        ++i;
-    }
+    unsigned long long t = _cpuTime;
+    for (ThreadList::iterator i = _threads.begin(); i != _threads.end(); ++i)
+      t += (*i)->getCpuTime();
 
-    return grp.waiters.empty();
+    return t;
   }
-};
-}
-//! Synchronization point for the Executor
-class ExecutorImpl {
-  typedef std::deque<ThreadImpl*> ThreadList;
-
-  bool _canceled;
-  FastMutex _lock;
-
-  //! Worker threads
-  ThreadList _threads;
-
-  WaiterQueue _queue;
 
- public:
-  ExecutorImpl() : _canceled(false) {}
+  ExecutorMetrics metrics() {
+    ExecutorMetrics m;
+    Guard<FastMutex> g(_lock);
 
-  WaiterQueue& getWaiterQueue() { return _queue; }
+    for (size_t i = 0; i < _shards.size(); ++i) _shards[i]->collect(m);
 
-  void registerThread(size_t generation) {
-    // Interrupt slow starting threads
-    if (getWaiterQueue().generation() != generation)
-      ThreadImpl::current()->interrupt();
+    m.queued = queued();
+    m.peakQueued = _peak > m.queued ? _peak : m.queued;
+    m.running = _threads.size();
 
-    // Enqueue for possible future interrupt()
-    else {
-      Guard<FastMutex> g(_lock);
-      _threads.push_back(ThreadImpl::current());
-    }
-  }
-
-  void unregisterThread() {
-    Guard<FastMutex> g(_lock);
-    std::remove(_threads.begin(), _threads.end(), ThreadImpl::current());
+    return m;
   }
 
   void cancel() {
@@ -329,26 +200,38 @@ class ExecutorImpl {
     getWaiterQueue().generation(true);
   }
 
-}; /* ExecutorImpl */
+}; /* ThreadedExecutorImpl */
 
 namespace {
 //! Wrap a generation and a group around a task
 class Worker : public Runnable {
-  CountedPtr<ExecutorImpl> _impl;
+  CountedPtr<ThreadedExecutorImpl> _impl;
   Task _task;
 
   size_t _generation;
   size_t _group;
 
+  //! Time the task was submitted
+  unsigned long _queued;
+
  public:
-  Worker(const CountedPtr<ExecutorImpl>& impl, const Task& task)
-      : _impl(impl), _task(task) {
+  Worker(const CountedPtr<ThreadedExecutorImpl>& impl, const Task& task)
+      : _impl(impl), _task(task), _queued(MetricsShard::now()) {
     std::pair<size_t, size_t> pr(_impl->getWaiterQueue().increment());
 
     _group = pr.first;
     _generation = pr.second;
   }
 
+  //! Create a Worker for a task of a batch that has already been counted
+  Worker(const CountedPtr<ThreadedExecutorImpl>& impl, const Task& task,
+         const std::pair<size_t, size_t>& pr)
+      : _impl(impl),
+        _task(task),
+        _generation(pr.second),
+        _group(pr.first),
+        _queued(MetricsShard::now()) {}
+
   size_t group() const { return _group; }
 
   size_t generation() const { return _generation; }
@@ -357,41 +240,79 @@ class Worker : public Runnable {
     // Register this thread once its begun; the generation is used to ensure
     // threads that are slow starting are properly interrupted
 
-    _impl->registerThread(generation());
+    MetricsShard& shard = _impl->registerThread(generation());
+
+    unsigned long start = MetricsShard::now();
+    bool failed = false;
 
     try {
       _task->run();
     } catch (...) {
       /* consume the exceptions the work propogates */
+      failed = true;
     }
 
-    _impl->getWaiterQueue().decrement(group());
+    // Record the task and unregister this thread before anyone waiting
+    // for it is woken
 
-    // Unregister this thread
+    shard.record(_queued, start, failed);
+    _impl->unregisterThread(shard);
 
-    _impl->unregisterThread();
+    _impl->getWaiterQueue().decrement(group());
   }
 
 }; /* Worker */
 }
 
-ThreadedExecutor::ThreadedExecutor() : _impl(new ExecutorImpl) {}
+ThreadedExecutor::ThreadedExecutor() : _impl(new ThreadedExecutorImpl) {}
 
 ThreadedExecutor::~ThreadedExecutor() {}
 
-void ThreadedExecutor::execute(const Task& task) {
+void ThreadedExecutor::Execute(const Task& task) {
+  // Canceled Executors will not accept new tasks
+  if (_impl->isCanceled()) throw CancellationException();
+
   Thread t(new Worker(_impl, task));
 }
 
-void ThreadedExecutor::interrupt() { _impl->interrupt(); }
+void ThreadedExecutor::Execute(const Task& task, CancellationToken token) {
+  Execute(token.bind(task));
+}
+
+void ThreadedExecutor::ExecuteAll(const Task* begin, const Task* end) {
+  if (begin == end) return;
+
+  // Canceled Executors will not accept new tasks
+  if (_impl->isCanceled()) throw CancellationException();
+
+  // Count the whole batch with one atomic add
+  size_t n = end - begin;
+  std::pair<size_t, size_t> pr(_impl->getWaiterQueue().increment(n));
+
+  for (; begin != end; ++begin, --n) {
+    try {
+      Thread t(new Worker(_impl, *begin, pr));
+    } catch (...) {
+      // The tasks that were not started will never be done
+      _impl->getWaiterQueue().decrement(pr.first, n);
+      throw;
+    }
+  }
+}
+
+unsigned long long ThreadedExecutor::getCpuTime() { return _impl->cpuTime(); }
+
+ExecutorMetrics ThreadedExecutor::getMetrics() { return _impl->metrics(); }
+
+void ThreadedExecutor::Interrupt() { _impl->interrupt(); }
 
-void ThreadedExecutor::cancel() { _impl->cancel(); }
+void ThreadedExecutor::Cancel() { _impl->cancel(); }
 
-bool ThreadedExecutor::isCanceled() { return _impl->isCanceled(); }
+bool ThreadedExecutor::IsCanceled() { return _impl->isCanceled(); }
 
-void ThreadedExecutor::wait() { _impl->getWaiterQueue().wait(0); }
+void ThreadedExecutor::Wait() { _impl->getWaiterQueue().wait(0); }
 
-bool ThreadedExecutor::wait(unsigned long timeout) {
+bool ThreadedExecutor::Wait(unsigned long timeout) {
   return _impl->getWaiterQueue().wait(timeout == 0 ? 1 : timeout);
 }
 }
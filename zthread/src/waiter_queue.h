@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTWAITERQUEUE_H__
+#define __ZTWAITERQUEUE_H__
+
+#include "atomic_ops.h"
+#include "zthread/condition.h"
+#include "zthread/fast_mutex.h"
+#include "zthread/guard.h"
+#include "zthread/non_copyable.h"
+#include "zthread/time.h"
+
+#include <utility>
+
+namespace zthread {
+
+/**
+ * @class WaiterQueue
+ *
+ * Tracks the tasks in flight on an executor, so that a thread waiting on
+ * the executor is woken once the tasks submitted before it began to wait
+ * have completed.
+ *
+ * Tasks are counted in one of two slots, chosen by the parity of the
+ * current epoch. A waiter advances the epoch, so that the tasks submitted
+ * before it are all counted in the slot that is no longer current, and
+ * waits for that slot to drain. The epoch is only advanced once the other
+ * slot has drained, which keeps the two apart.
+ *
+ * Counting a task costs one atomic add when it is submitted and one when it
+ * completes. The lock and the Condition are only touched by waiters, and by
+ * the task that drains the slot someone is waiting for.
+ */
+class WaiterQueue : private NonCopyable {
+  // Kept on separate cache lines, tasks only touch the counts
+  char _pad0[64];
+  volatile size_t _count[2];
+  char _pad1[64];
+  volatile size_t _epoch;
+  volatile size_t _generation;
+
+  //! Threads inside wait()
+  volatile size_t _waiting;
+  char _pad2[64];
+
+  FastMutex _lock;
+  Condition _drained;
+
+ public:
+  //! Milliseconds elapsed since the given time
+  static unsigned long elapsed(const Time& start) {
+    Time now;
+    now -= start;
+
+    return now.seconds() * 1000 + now.milliseconds();
+  }
+
+  WaiterQueue() : _epoch(0), _generation(0), _waiting(0), _drained(_lock) {
+    _count[0] = 0;
+    _count[1] = 0;
+  }
+
+  /**
+   * Wait for the tasks counted before this call to complete.
+   *
+   * @param timeout milliseconds to wait, or 0 to wait indefinitely
+   * @return bool false if the timeout expired first
+   *
+   * @exception InterruptedException thrown if the thread is interrupted
+   */
+  bool wait(unsigned long timeout) {
+    Guard<FastMutex> g(_lock);
+    Time start;
+
+    atomic::add(&_waiting, (size_t)1);
+
+    const size_t first = atomic::load(&_epoch);
+    bool done = false;
+
+    try {
+      for (;;) {
+        size_t epoch = atomic::load(&_epoch);
+
+        if (epoch == first) {
+          // Advance once the tasks of the previous epoch have drained
+          if (atomic::load(&_count[(first + 1) & 1]) == 0) {
+            atomic::add(&_epoch, (size_t)1);
+            continue;
+          }
+
+        } else if (epoch != first + 1 ||
+                   atomic::load(&_count[first & 1]) == 0) {
+          // Either the slot has drained, or it had to before the epoch could
+          // be advanced again
+          done = true;
+          break;
+        }
+
+        if (timeout == 0)
+          _drained.Wait();
+
+        else {
+          unsigned long ms = elapsed(start);
+          if (ms >= timeout || !_drained.Wait(timeout - ms)) break;
+        }
+      }
+
+    } catch (...) {
+      atomic::add(&_waiting, (size_t)-1);
+      throw;
+    }
+
+    atomic::add(&_waiting, (size_t)-1);
+    return done;
+  }
+
+  /**
+   * Count the given number of tasks as submitted.
+   *
+   * @return the slot they were counted in, and the current generation
+   */
+  std::pair<size_t, size_t> increment(size_t count = 1) {
+    for (;;) {
+      size_t slot = atomic::load(&_epoch) & 1;
+      atomic::add(&_count[slot], count);
+
+      // The epoch was advanced in the meantime, and a waiter may already
+      // have found the slot drained. Count the tasks again in the current
+      // one, they may just as well have been submitted afterwards
+      if ((atomic::load(&_epoch) & 1) == slot)
+        return std::make_pair(slot, generation());
+
+      decrement(slot, count);
+    }
+  }
+
+  /**
+   * Count the given number of tasks as completed.
+   *
+   * @param slot slot the tasks were counted in
+   * @param count number of tasks
+   */
+  void decrement(size_t slot, size_t count = 1) {
+    if (atomic::add(&_count[slot], (size_t)0 - count) != 0) return;
+
+    // Only a slot that is no longer current can be waited on
+    if ((atomic::load(&_epoch) & 1) == slot || atomic::load(&_waiting) == 0)
+      return;
+
+    Guard<FastMutex> g(_lock);
+    _drained.Broadcast();
+  }
+
+  //! Get the number of tasks counted that have not completed
+  size_t pending() {
+    return atomic::load(&_count[0]) + atomic::load(&_count[1]);
+  }
+
+  /**
+   * Get the current generation, or advance it and get the previous one.
+   * Tasks submitted in an earlier generation are interrupted by the workers
+   * that run them.
+   */
+  size_t generation(bool next = false) {
+    return next ? atomic::add(&_generation, (size_t)1) - 1
+                : atomic::load(&_generation);
+  }
+};
+
+}  // namespace zthread
+
+#endif  // __ZTWAITERQUEUE_H__
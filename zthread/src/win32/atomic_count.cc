@@ -32,33 +32,36 @@
 
 namespace zthread {
 
-AtomicCount::AtomicCount() { value_ = reinterpret_cast<void*>(new LONG(0)); }
-
-AtomicCount::~AtomicCount() {
-  assert(*reinterpret_cast<LPLONG>(value_) == 0);
-  delete reinterpret_cast<LPLONG>(value_);
+// The count is kept in the storage of value_ itself, it is never larger
+// than a pointer, so creating an AtomicCount does not allocate
+static inline LPLONG counter(void*& value) {
+  return reinterpret_cast<LPLONG>(&value);
 }
 
+AtomicCount::AtomicCount() { *counter(value_) = 0; }
+
+AtomicCount::~AtomicCount() { assert(*counter(value_) == 0); }
+
 //! Postfix decrement and return the previous value
 size_t AtomicCount::operator--(int) {
-	LONG v = ::InterlockedDecrement(reinterpret_cast<LPLONG>(value_));
+	LONG v = ::InterlockedDecrement(counter(value_));
 	return ++v;
 }
 
 //! Postfix increment and return the previous value
 size_t AtomicCount::operator++(int) {
-	LONG v = ::InterlockedIncrement(reinterpret_cast<LPLONG>(value_));
+	LONG v = ::InterlockedIncrement(counter(value_));
 	return --v;
 }
 
 //! Prefix decrement and return the current value
 size_t AtomicCount::operator--() {
-	return ::InterlockedDecrement(reinterpret_cast<LPLONG>(value_));
+	return ::InterlockedDecrement(counter(value_));
 }
 
 //! Prefix increment and return the current value
 size_t AtomicCount::operator++() {
-	return ::InterlockedIncrement(reinterpret_cast<LPLONG>(value_));
+	return ::InterlockedIncrement(counter(value_));
 }
 
 }; // namespace zthread
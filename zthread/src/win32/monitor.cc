@@ -81,6 +81,10 @@ Monitor::STATE Monitor::wait(unsigned long ms) {
   // Block until the event is set.
   _waitLock.Release();
 
+  // Let the listener know the thread is about to block
+  BlockingListener* listener = _listener;
+  if (listener) listener->blocking();
+
   // The event is manual reset so this lack of atmoicity will not
   // be an issue
 
@@ -104,6 +108,8 @@ Monitor::STATE Monitor::wait(unsigned long ms) {
   // Acquire the internal lock & release the external lock
   _waitLock.Release();
 
+  if (listener) listener->unblocked();
+
   // Reaquire the external lock, keep from deadlocking threads calling
   // notify(), interrupt(), etc.
   _lock.Acquire();
@@ -148,6 +148,73 @@ bool ThreadOps::getPriority(ThreadOps* impl, Priority& p) {
   return result;
 }
 
+bool ThreadOps::setName(ThreadOps* impl, const char* name) { return false; }
+
+bool ThreadOps::getName(char* name, size_t len) { return false; }
+
+bool ThreadOps::getCpuTime(ThreadOps* impl, unsigned long long& usec) {
+  assert(impl);
+
+  // Reference threads have no handle, but can query themselves
+  HANDLE hThread = impl->_hThread;
+  if (hThread == NULL && isCurrent(impl)) hThread = ::GetCurrentThread();
+
+  FILETIME creation, exit, kernel, user;
+
+  if (hThread == NULL ||
+      !::GetThreadTimes(hThread, &creation, &exit, &kernel, &user))
+    return false;
+
+  // FILETIMEs count 100 nanosecond intervals
+  ULARGE_INTEGER k, u;
+  k.LowPart = kernel.dwLowDateTime;
+  k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;
+  u.HighPart = user.dwHighDateTime;
+
+  usec = (k.QuadPart + u.QuadPart) / 10;
+  return true;
+}
+
+bool ThreadOps::setAffinity(size_t n) {
+  DWORD_PTR process, system;
+  if (!::GetProcessAffinityMask(::GetCurrentProcess(), &process, &system))
+    return false;
+
+  // Find the n-th processor in the process mask
+  for (size_t cpu = 0; cpu < sizeof(DWORD_PTR) * 8; ++cpu) {
+    DWORD_PTR bit = (DWORD_PTR)1 << cpu;
+
+    if ((process & bit) && n-- == 0)
+      return ::SetThreadAffinityMask(::GetCurrentThread(), bit) != 0;
+  }
+
+  return false;
+}
+
+bool ThreadOps::clearAffinity() {
+  DWORD_PTR process, system;
+  if (!::GetProcessAffinityMask(::GetCurrentProcess(), &process, &system))
+    return false;
+
+  return ::SetThreadAffinityMask(::GetCurrentThread(), process) != 0;
+}
+
+size_t ThreadOps::processors() {
+  DWORD_PTR process, system;
+  if (::GetProcessAffinityMask(::GetCurrentProcess(), &process, &system)) {
+    size_t n = 0;
+    for (; process; process &= process - 1) ++n;
+
+    if (n > 0) return n;
+  }
+
+  SYSTEM_INFO info;
+  ::GetSystemInfo(&info);
+
+  return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
 bool ThreadOps::spawn(Runnable* task) {
 // Start the thread.
 #if defined(HAVE_BEGINTHREADEX)
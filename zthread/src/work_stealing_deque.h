@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2005, Eric Crahen
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished
+ * to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR
+ * IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+#ifndef __ZTWORKSTEALINGDEQUE_H__
+#define __ZTWORKSTEALINGDEQUE_H__
+
+#include "atomic_ops.h"
+#include "zthread/non_copyable.h"
+
+#include <vector>
+
+namespace zthread {
+
+/**
+ * @class WorkStealingDeque
+ *
+ * A Chase-Lev work stealing deque. A single owner thread pushes and takes
+ * items at the bottom without contention, while any number of other threads
+ * steal from the top. Only the last item is ever contended between the
+ * owner and the thieves, and that race is settled by a single compare and
+ * swap.
+ *
+ * The buffer grows as needed. Outgrown buffers are kept until the deque is
+ * destroyed since a thief may still be reading from one.
+ *
+ * T must be a word sized type, such as a pointer.
+ */
+template <typename T>
+class WorkStealingDeque : private NonCopyable {
+  //! Circular buffer of items, its capacity is a power of 2
+  struct Buffer {
+    long capacity;
+    volatile T* items;
+
+    Buffer(long n) : capacity(n), items(new T[n]) {}
+
+    ~Buffer() { delete[] items; }
+
+    T get(long i) { return atomic::load(&items[i & (capacity - 1)]); }
+
+    void put(long i, T item) { atomic::store(&items[i & (capacity - 1)], item); }
+
+    //! Copy the items in [top, bottom) into a buffer twice as large
+    Buffer* grow(long top, long bottom) {
+      Buffer* buf = new Buffer(capacity * 2);
+
+      for (long i = top; i < bottom; ++i) buf->put(i, get(i));
+
+      return buf;
+    }
+  };
+
+  volatile long _top;
+  volatile long _bottom;
+
+  Buffer* volatile _buffer;
+
+  //! Outgrown buffers, accessed only by the owner
+  std::vector<Buffer*> _retired;
+
+ public:
+  WorkStealingDeque(long capacity = 64)
+      : _top(0), _bottom(0), _buffer(new Buffer(capacity)) {}
+
+  ~WorkStealingDeque() {
+    delete _buffer;
+
+    for (size_t i = 0; i < _retired.size(); ++i) delete _retired[i];
+  }
+
+  /**
+   * Push an item onto the bottom of the deque.
+   *
+   * @pre called only by the owner
+   */
+  void push(T item) {
+    long b = atomic::load(&_bottom);
+    long t = atomic::load(&_top);
+
+    Buffer* buf = _buffer;
+
+    if (b - t >= buf->capacity) {
+      _retired.push_back(buf);
+
+      buf = buf->grow(t, b);
+      atomic::store(&_buffer, buf);
+    }
+
+    buf->put(b, item);
+
+    // Publish the item to the thieves
+    atomic::store(&_bottom, b + 1);
+  }
+
+  /**
+   * Take the item most recently pushed.
+   *
+   * @return bool false if the deque was empty
+   * @pre called only by the owner
+   */
+  bool take(T& item) {
+    long b = atomic::load(&_bottom) - 1;
+    Buffer* buf = _buffer;
+
+    // Claim the bottom item before looking at what the thieves have done
+    atomic::store(&_bottom, b);
+    atomic::fence();
+
+    long t = atomic::load(&_top);
+
+    if (t > b) {
+      atomic::store(&_bottom, b + 1);
+      return false;
+    }
+
+    item = buf->get(b);
+
+    if (t == b) {
+      // The last item, race the thieves for it
+      bool won = atomic::cas(&_top, t, t + 1);
+      atomic::store(&_bottom, b + 1);
+
+      return won;
+    }
+
+    return true;
+  }
+
+  /**
+   * Steal the item least recently pushed.
+   *
+   * @return bool false if the deque was empty, or if another thread took
+   *         the item first
+   */
+  bool steal(T& item) {
+    long t = atomic::load(&_top);
+    atomic::fence();
+    long b = atomic::load(&_bottom);
+
+    if (t >= b) return false;
+
+    item = atomic::load(&_buffer)->get(t);
+
+    return atomic::cas(&_top, t, t + 1);
+  }
+
+  //! Test for items, the result is only a hint unless called by the owner
+  bool empty() const { return atomic::load(&_top) >= atomic::load(&_bottom); }
+};
+
+}  // namespace zthread
+
+#endif  // __ZTWORKSTEALINGDEQUE_H__
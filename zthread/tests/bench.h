@@ -0,0 +1,54 @@
+/*
+ * Helpers shared by the benchmarks in this directory. Each benchmark is a
+ * standalone program printing its figures; results depend on the machine,
+ * most of them only show a difference with several processors.
+ */
+
+#ifndef __ZTBENCH_H__
+#define __ZTBENCH_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+//! Monotonic time in seconds
+inline double now() {
+#if defined(_WIN32)
+  LARGE_INTEGER f, t;
+  QueryPerformanceFrequency(&f);
+  QueryPerformanceCounter(&t);
+  return (double)t.QuadPart / (double)f.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+//! Processors online
+inline long cpus() {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? n : 1;
+#endif
+}
+
+//! Integer argument i of the command line, or the default
+inline long arg(int argc, char** argv, int i, long def) {
+  return argc > i ? atol(argv[i]) : def;
+}
+}
+
+#endif  // __ZTBENCH_H__
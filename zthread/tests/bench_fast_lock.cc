@@ -0,0 +1,68 @@
+/*
+ * Contended FastMutex: T threads each take the lock N times around a short
+ * critical section. Reports the time per acquisition, and the spread
+ * between the first and the last thread to finish.
+ *
+ * usage: bench_fast_lock [iterations]
+ */
+
+#include "bench.h"
+
+#include <zthread/zthread.h>
+
+#include <vector>
+
+using namespace zthread;
+
+static FastMutex lock;
+static volatile long counter;
+static double finished[64];
+
+class Contender : public Runnable {
+  long _n;
+  int _id;
+  double _start;
+
+ public:
+  Contender(long n, int id, double start) : _n(n), _id(id), _start(start) {}
+
+  void run() {
+    for (long i = 0; i < _n; ++i) {
+      lock.Acquire();
+      counter = counter + 1;
+      lock.Release();
+    }
+
+    finished[_id] = bench::now() - _start;
+  }
+};
+
+int main(int argc, char** argv) {
+  long n = bench::arg(argc, argv, 1, 200000);
+
+  for (int t = 1; t <= 64; t *= 4) {
+    double start = bench::now();
+    {
+      std::vector<Thread*> threads;
+      for (int i = 0; i < t; ++i)
+        threads.push_back(new Thread(new Contender(n, i, start)));
+
+      for (int i = 0; i < t; ++i) {
+        threads[i]->Wait();
+        delete threads[i];
+      }
+    }
+    double total = bench::now() - start;
+
+    double first = finished[0], last = finished[0];
+    for (int i = 1; i < t; ++i) {
+      if (finished[i] < first) first = finished[i];
+      if (finished[i] > last) last = finished[i];
+    }
+
+    printf("%d threads: %.1f ns/acquire, finish spread %.1f ms\n", t,
+           total * 1e9 / (n * t), (last - first) * 1e3);
+  }
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * parallelFor and parallelReduce scaling: runs a memory-bound kernel (a
+ * STREAM style triad over arrays well beyond the caches) and a
+ * compute-bound kernel (a reduction of trigonometric terms) with 1 thread
+ * up to one thread per processor, and reports the best time of several
+ * runs and the speedup over a single thread. The caller takes part in each
+ * loop, so t threads are the caller and a pool of t - 1.
+ *
+ * usage: bench_parallel_scaling [max threads] [array length]
+ */
+
+#include "bench.h"
+
+#include <zthread/zthread.h>
+
+#include <functional>
+#include <math.h>
+#include <vector>
+
+using namespace zthread;
+
+struct Triad {
+  double* a;
+  const double* b;
+  const double* c;
+
+  void operator()(size_t first, size_t last) const {
+    for (size_t i = first; i < last; ++i) a[i] = b[i] + 3.0 * c[i];
+  }
+};
+
+struct Trig {
+  double step;
+
+  double operator()(size_t first, size_t last, double acc) const {
+    for (size_t i = first; i < last; ++i)
+      acc += sin(i * step) * cos(i * 2 * step);
+
+    return acc;
+  }
+};
+
+static const int RUNS = 5;
+
+//! Best time of several runs of a kernel with t threads
+template <typename Kernel>
+static double best(long t, Kernel& kernel) {
+  double fastest = 0;
+
+  PoolExecutor pool(t > 1 ? t - 1 : 1);
+
+  for (int r = 0; r < RUNS; ++r) {
+    double start = bench::now();
+    kernel(pool, t);
+    double elapsed = bench::now() - start;
+
+    if (r == 0 || elapsed < fastest) fastest = elapsed;
+  }
+
+  return fastest;
+}
+
+struct Memory {
+  size_t n;
+  Triad triad;
+
+  void operator()(PoolExecutor& pool, long t) {
+    if (t == 1)
+      triad(0, n);
+    else
+      parallelFor(pool, 0, n, 16384, triad);
+  }
+};
+
+struct Compute {
+  size_t n;
+
+  //! Read and written through volatile, so no run is optimized away
+  volatile double step;
+  volatile double result;
+
+  void operator()(PoolExecutor& pool, long t) {
+    Trig trig = {step};
+
+    if (t == 1)
+      result = trig(0, n, 0.0);
+    else
+      result = parallelReduce(pool, 0, n, 4096, 0.0, trig,
+                              std::plus<double>());
+  }
+};
+
+int main(int argc, char** argv) {
+  long max = bench::arg(argc, argv, 1, bench::cpus());
+  size_t n = (size_t)bench::arg(argc, argv, 2, 1 << 23);
+
+  std::vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+
+  Memory memory;
+  memory.n = n;
+  memory.triad.a = &a[0];
+  memory.triad.b = &b[0];
+  memory.triad.c = &c[0];
+
+  Compute compute;
+  compute.n = n / 2;
+  compute.step = 0.001;
+
+  double memory1 = 0, compute1 = 0;
+
+  printf("threads  triad ms (GB/s, speedup)   trig ms (speedup)\n");
+
+  for (long t = 1; t <= max; ++t) {
+    double m = best(t, memory);
+    double c = best(t, compute);
+
+    if (t == 1) {
+      memory1 = m;
+      compute1 = c;
+    }
+
+    printf("%7ld  %8.2f (%5.1f, %4.2fx)   %7.2f (%4.2fx)\n", t, m * 1e3,
+           3.0 * sizeof(double) * n / m * 1e-9, memory1 / m, c * 1e3,
+           compute1 / c);
+  }
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+ * PoolExecutor submission: submits N empty tasks to a pool of 2 workers in
+ * each scheduling mode, waiting every 512 tasks, and reports the tasks run
+ * per second and the heap allocations made per task. Once the pool is warm
+ * the task wrappers are recycled, so a shared Task should cost well under
+ * one allocation.
+ *
+ * usage: bench_pool_submit [tasks]
+ *
+ * Allocations are counted by replacing the global operator new, which also
+ * sees those made inside the library where the platform links it that way.
+ */
+
+#include "bench.h"
+
+#include <zthread/zthread.h>
+
+#include <new>
+
+using namespace zthread;
+
+static volatile long allocations;
+
+void* operator new(size_t n) {
+#if defined(_MSC_VER)
+  InterlockedIncrement(&allocations);
+#else
+  __sync_fetch_and_add(&allocations, 1);
+#endif
+
+  void* p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+
+  return p;
+}
+
+void operator delete(void* p) throw() { free(p); }
+
+class Empty : public Runnable {
+ public:
+  void run() {}
+};
+
+int main(int argc, char** argv) {
+  long n = bench::arg(argc, argv, 1, 500000);
+
+  const char* names[] = {"SharedQueue", "WorkStealing", "LockFree",
+                         "Prioritized"};
+
+  for (int m = 0; m < 4; ++m) {
+    PoolExecutor pool(2, (PoolExecutor::Scheduling)m);
+    Task task(new Empty);
+
+    // Warm up, filling the spare wrappers
+    for (int i = 0; i < 2000; ++i) pool.Execute(task);
+    pool.Wait();
+
+    long before = allocations;
+    double start = bench::now();
+
+    for (long i = 0; i < n; ++i) {
+      pool.Execute(task);
+      if ((i & 511) == 511) pool.Wait();
+    }
+    pool.Wait();
+
+    double elapsed = bench::now() - start;
+
+    printf("%-12s %.2fM tasks/s, %.3f allocations/task\n", names[m],
+           n / elapsed * 1e-6, (double)(allocations - before) / n);
+  }
+
+  return 0;
+}
@@ -0,0 +1,124 @@
+/*
+ * Thread footprint: spawns N threads that park in sleep(), then reports
+ * the heap and resident memory they added per thread, the time to spawn
+ * them and the time to interrupt and join them all. Each count runs three
+ * passes: with thread reuse off, with reuse on so the threads are kept
+ * parked when they exit, and once more to run on the threads kept parked.
+ *
+ * usage: bench_thread_footprint [max threads]
+ *
+ * The larger counts need the process thread limit (ulimit -u) and
+ * kernel.threads-max raised above them; a run that hits a limit reports
+ * the number of threads it reached.
+ */
+
+#include "bench.h"
+
+#include <zthread/zthread.h>
+
+#include <vector>
+
+#if defined(__linux__)
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+using namespace zthread;
+
+class Parked : public Runnable {
+ public:
+  void run() {
+    try {
+      Thread::sleep(3600 * 1000);
+    } catch (InterruptedException&) {
+    }
+  }
+};
+
+//! Bytes in use on the heap, or 0 when it cannot be measured
+static double heap() {
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+  return (double)mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+//! Resident set size in bytes, or 0 when it cannot be measured
+static double resident() {
+#if defined(__linux__)
+  long pages = 0, rss = 0;
+
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f) {
+    if (fscanf(f, "%ld %ld", &pages, &rss) != 2) rss = 0;
+    fclose(f);
+  }
+
+  return (double)rss * sysconf(_SC_PAGESIZE);
+#else
+  return 0;
+#endif
+}
+
+//! How long exited threads are kept parked for reuse
+static const unsigned long CACHE = 10 * 60 * 1000;
+
+static void measure(long n, const char* pass) {
+  std::vector<Thread*> threads;
+  threads.reserve(n);
+
+  double heap0 = heap(), rss0 = resident();
+  double start = bench::now();
+
+  try {
+    for (long i = 0; i < n; ++i) threads.push_back(new Thread(new Parked));
+  } catch (SynchronizationException&) {
+  }
+
+  double spawned = bench::now() - start;
+  double heap1 = heap(), rss1 = resident();
+
+  long m = (long)threads.size();
+
+  start = bench::now();
+
+  for (long i = 0; i < m; ++i) threads[i]->interrupt();
+
+  for (long i = 0; i < m; ++i) {
+    threads[i]->Wait();
+    delete threads[i];
+  }
+
+  double exited = bench::now() - start;
+
+  if (m == 0) {
+    printf("%ld threads, %s: none could be spawned\n", n, pass);
+    return;
+  }
+
+  printf(
+      "%ld threads%s, %s: %.0f heap bytes/thread, %.0f resident "
+      "bytes/thread, spawn %.1f us/thread, exit %.1f us/thread\n",
+      m, m < n ? " (limit reached)" : "", pass, (heap1 - heap0) / m,
+      (rss1 - rss0) / m, spawned * 1e6 / m, exited * 1e6 / m);
+}
+
+int main(int argc, char** argv) {
+  long max = bench::arg(argc, argv, 1, 50000);
+
+  long counts[] = {1000, 10000, 50000};
+
+  for (int i = 0; i < 3 && counts[i] <= max; ++i) {
+    Thread::setCacheTimeout(0);
+    measure(counts[i], "new");
+
+    Thread::setCacheTimeout(CACHE);
+    measure(counts[i], "new, parked on exit");
+    measure(counts[i], "reused");
+  }
+
+  Thread::setCacheTimeout(0);
+
+  return 0;
+}
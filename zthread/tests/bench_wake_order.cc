@@ -0,0 +1,153 @@
+/*
+ * PoolExecutor wake order: under a light load, two tasks at a time with
+ * gaps between them, compares waking the longest idle worker (FIFO) with
+ * waking the most recently idle one (LIFO). Each task touches a 256 KB
+ * buffer belonging to the worker running it, so a worker woken while its
+ * buffer is still cached runs the task faster. Reports, for each
+ * scheduling mode, the distinct workers that ran tasks and the time per
+ * task; then, for an elastic pool after a burst, how many workers remain
+ * once the light load has run past the idle timeout.
+ *
+ * usage: bench_wake_order [pairs]
+ */
+
+#include "bench.h"
+
+#include <zthread/zthread.h>
+
+#include <string.h>
+
+using namespace zthread;
+
+static const size_t BUFFER = 256 * 1024;
+static const int WORKERS = 8;
+
+static AtomicCount workers;
+
+//! Numbers the threads in the order they first run a task
+struct NextWorker {
+  int operator()() { return (int)(workers++); }
+};
+
+static ThreadLocal<int, NextWorker> worker;
+
+//! Buffer each worker touches
+static char* buffers[64];
+
+class Touch : public Runnable {
+  double* _took;
+
+ public:
+  Touch(double* took) : _took(took) {}
+
+  void run() {
+    int id = worker.get() % 64;
+
+    if (!buffers[id]) {
+      buffers[id] = new char[BUFFER];
+      memset(buffers[id], 0, BUFFER);
+    }
+
+    double start = bench::now();
+
+    char* b = buffers[id];
+    for (int r = 0; r < 4; ++r)
+      for (size_t i = 0; i < BUFFER; i += 64) b[i]++;
+
+    *_took = bench::now() - start;
+  }
+};
+
+static void pause(long usec) {
+  double until = bench::now() + usec * 1e-6;
+  while (bench::now() < until) Thread::yield();
+}
+
+//! Run pairs of tasks with gaps, returning the mean time per task
+static double light(PoolExecutor& pool, long pairs, long gap) {
+  double total = 0;
+  long counted = 0;
+
+  for (long i = 0; i < pairs; ++i) {
+    double a = 0, b = 0;
+
+    pool.Execute(Task(new Touch(&a)));
+    pool.Execute(Task(new Touch(&b)));
+    pool.Wait();
+
+    // The first pairs warm the buffers up
+    if (i >= pairs / 10) {
+      total += a + b;
+      counted += 2;
+    }
+
+    pause(gap);
+  }
+
+  return counted ? total / counted : 0;
+}
+
+//! Workers attached to the pool, and those that completed any task
+static void count(PoolExecutor& pool, size_t& active, size_t& used) {
+  ExecutorMetrics m = pool.getMetrics();
+
+  active = used = 0;
+  for (size_t i = 0; i < m.workers.size(); ++i) {
+    if (m.workers[i].active) ++active;
+    if (m.workers[i].completed > 0) ++used;
+  }
+}
+
+int main(int argc, char** argv) {
+  long pairs = bench::arg(argc, argv, 1, 200);
+
+  PoolExecutor::Scheduling modes[] = {
+      PoolExecutor::SharedQueue, PoolExecutor::WorkStealing,
+      PoolExecutor::LockFree, PoolExecutor::Prioritized};
+  const char* names[] = {"SharedQueue", "WorkStealing", "LockFree",
+                         "Prioritized"};
+
+  PoolExecutor::WakeOrder orders[] = {PoolExecutor::LongestIdle,
+                                      PoolExecutor::MostRecentlyIdle};
+  const char* wakes[] = {"LongestIdle", "MostRecentlyIdle"};
+
+  for (int m = 0; m < 4; ++m)
+    for (int o = 0; o < 2; ++o) {
+      PoolExecutor pool(WORKERS, modes[m]);
+      pool.wakeOrder(orders[o]);
+
+      double took = light(pool, pairs, 200);
+
+      size_t active, used;
+      count(pool, active, used);
+
+      printf("%-12s %-16s %lu workers used, %.1f us/task\n", names[m],
+             wakes[o], (unsigned long)used, took * 1e6);
+    }
+
+  for (int o = 0; o < 2; ++o) {
+    PoolExecutor pool(1, WORKERS, 100);
+    pool.wakeOrder(orders[o]);
+
+    // A burst grows the pool to its maximum
+    double ignored[WORKERS];
+    for (int i = 0; i < WORKERS; ++i)
+      pool.Execute(Task(new Touch(&ignored[i])));
+    pool.Wait();
+
+    size_t grown, used, after;
+    count(pool, grown, used);
+
+    // Light load for longer than the idle timeout
+    double start = bench::now();
+    while (bench::now() - start < 0.5) light(pool, 10, 100);
+
+    count(pool, after, used);
+
+    printf("elastic 1..%d %-16s %lu workers after the burst, %lu after "
+           "light load\n",
+           WORKERS, wakes[o], (unsigned long)grown, (unsigned long)after);
+  }
+
+  return 0;
+}